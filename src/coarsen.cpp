@@ -0,0 +1,103 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "coarsen.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+namespace mrfsat {
+
+CoarseLevel coarsenGraph(const CSRGraph& graph, int nodes, const std::vector<int>& members,
+                         const std::vector<float>& source_values, const std::vector<float>& sink_values) {
+    auto distance = [&](int a, int b) {
+        return std::abs(source_values[a] - source_values[b]) + std::abs(sink_values[a] - sink_values[b]);
+    };
+    std::vector<int> mate(nodes + 1, 0);
+    for (int node = 1; node <= nodes; node++) {
+        if (mate[node]) continue;
+        int best = 0;
+        float best_weight = 0;
+        graph.forEachEdge(node, [&](int neighbor, float weight) {
+            if (neighbor < 1 || neighbor > nodes || neighbor == node || mate[neighbor]) return;
+            if (!best || weight > best_weight || (weight == best_weight && distance(node, neighbor) < distance(node, best))) {
+                best = neighbor;
+                best_weight = weight;
+            }
+        });
+        mate[node] = best ? best : node;
+        if (best) mate[best] = node;
+    }
+
+    CoarseLevel level;
+    level.coarse_of.assign(nodes + 1, 0);
+    level.members.assign(1, 0);
+    level.source_values.assign(1, 0);
+    level.sink_values.assign(1, 0);
+    for (int node = 1; node <= nodes; node++) {
+        if (level.coarse_of[node]) continue;
+        int coarse = ++level.nodes;
+        int size = members[node];
+        double source = (double)source_values[node] * members[node];
+        double sink = (double)sink_values[node] * members[node];
+        level.coarse_of[node] = coarse;
+        if (mate[node] != node) {
+            int other = mate[node];
+            level.coarse_of[other] = coarse;
+            size += members[other];
+            source += (double)source_values[other] * members[other];
+            sink += (double)sink_values[other] * members[other];
+        }
+        level.members.push_back(size);
+        level.source_values.push_back(source / size);
+        level.sink_values.push_back(sink / size);
+    }
+
+    // the rows of a pair are merged and sorted, repeated neighbors added up
+    CSRGraph& coarse = level.graph;
+    coarse.offsets.assign(level.nodes + 2, 0);
+    std::vector<int> first_of(level.nodes + 1, 0);
+    for (int node = nodes; node >= 1; node--) {
+        first_of[level.coarse_of[node]] = node;
+    }
+    std::vector<std::pair<int, float> > row;
+    for (int coarse_node = 1; coarse_node <= level.nodes; coarse_node++) {
+        row.clear();
+        int first = first_of[coarse_node];
+        int pair[2] = {first, mate[first]};
+        for (int member = 0; member < (pair[1] == first ? 1 : 2); member++) {
+            graph.forEachEdge(pair[member], [&](int neighbor, float weight) {
+                if (neighbor < 1 || neighbor > nodes || level.coarse_of[neighbor] == coarse_node) return;
+                row.emplace_back(level.coarse_of[neighbor], weight);
+            });
+        }
+        std::stable_sort(row.begin(), row.end(),
+            [](const std::pair<int, float>& a, const std::pair<int, float>& b) { return a.first < b.first; });
+        for (size_t edge = 0; edge < row.size(); edge++) {
+            if (edge > 0 && row[edge].first == row[edge - 1].first) {
+                coarse.weights.back() += row[edge].second;
+                continue;
+            }
+            coarse.neighbors.push_back(row[edge].first);
+            coarse.weights.push_back(row[edge].second);
+        }
+        coarse.offsets[coarse_node + 1] = coarse.neighbors.size();
+    }
+    coarse.compact();
+    return level;
+}
+}
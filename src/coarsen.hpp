@@ -0,0 +1,46 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+
+#include <vector>
+#include "csrgraph.hpp"
+
+namespace mrfsat {
+
+/*
+    One level of the multilevel mode: every node of the finer graph was
+    matched with at most one neighbor and the pair became node
+    coarse_of[node] of graph, numbered from 1 in order of its first member.
+    Edges between two pairs add up their weights, edges inside a pair go.
+    The source and sink values of a coarse node are the means of those of
+    the finest nodes it stands for, members of them.
+*/
+struct CoarseLevel {
+    CSRGraph graph;
+    int nodes = 0;
+    std::vector<int> coarse_of;
+    std::vector<int> members;
+    std::vector<float> source_values;
+    std::vector<float> sink_values;
+};
+
+// coarsens nodes 1 .. nodes of graph by a heavy edge matching, ties going
+// to the neighbor with the closest source and sink values
+CoarseLevel coarsenGraph(const CSRGraph& graph, int nodes, const std::vector<int>& members,
+                         const std::vector<float>& source_values, const std::vector<float>& sink_values);
+}
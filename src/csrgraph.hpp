@@ -0,0 +1,195 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+
+#include <vector>
+#include <cstdint>
+#include "scratch.hpp"
+
+namespace mrfsat {
+
+enum class RowKind { Plain, Uniform, Mixed };
+
+struct CSRGraph {
+    /*
+        Weighted adjacency in compressed sparse row form. The neighbors of
+        node i are neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1],
+        sorted by id, with the matching weights.
+
+        Once compacted, a row whose edges all weigh the same, as those of a
+        clause or of any constraint with a single coefficient, keeps that
+        weight once in row_weights and none in weights. So do the edges that
+        point at such a row, every edge having its reverse of equal weight.
+        The weights kept for row i start at weight_offsets[i]. Read the
+        weights through forEachEdge, which handles both forms.
+
+        The edge arrays can be kept out of core, see scratch.hpp; every
+        pass over them goes through the rows in order.
+    */
+    std::vector<int64_t> offsets;
+    ScratchVector<int> neighbors;
+    ScratchVector<float> weights;
+    std::vector<int64_t> weight_offsets;
+    std::vector<float> row_weights;
+    std::vector<char> uniform_rows;
+
+    int rows() const { return offsets.empty() ? 0 : static_cast<int>(offsets.size() - 1); }
+    int64_t edges() const { return neighbors.size(); }
+    int64_t begin(int node) const { return node < rows() ? offsets[node] : 0; }
+    int64_t end(int node) const { return node < rows() ? offsets[node + 1] : 0; }
+    bool compacted() const { return !weight_offsets.empty(); }
+    bool uniformRow(int node) const { return node < (int)uniform_rows.size() && uniform_rows[node]; }
+    bool outOfCore() const { return neighbors.get_allocator().out_of_core; }
+    void setOutOfCore(bool out_of_core) {
+        // moves the edge arrays to where they are to be kept
+        ScratchVector<int> moved_neighbors(neighbors.begin(), neighbors.end(), ScratchAllocator<int>(out_of_core));
+        ScratchVector<float> moved_weights(weights.begin(), weights.end(), ScratchAllocator<float>(out_of_core));
+        neighbors.swap(moved_neighbors);
+        weights.swap(moved_weights);
+    }
+
+    template <RowKind Kind, typename Visit>
+    void visitRow(int node, Visit& visit) const {
+        int64_t row_end = offsets[node + 1];
+        if constexpr (Kind == RowKind::Plain) {
+            for (int64_t edge = offsets[node]; edge < row_end; edge++) {
+                visit(neighbors[edge], weights[edge]);
+            }
+        } else if constexpr (Kind == RowKind::Uniform) {
+            float weight = row_weights[node];
+            for (int64_t edge = offsets[node]; edge < row_end; edge++) {
+                visit(neighbors[edge], weight);
+            }
+        } else {
+            int64_t kept = weight_offsets[node];
+            for (int64_t edge = offsets[node]; edge < row_end; edge++) {
+                int neighbor = neighbors[edge];
+                visit(neighbor, uniform_rows[neighbor] ? row_weights[neighbor] : weights[kept++]);
+            }
+        }
+    }
+    template <typename Visit>
+    void forEachEdge(int node, Visit visit) const {
+        // visit(neighbor, weight) for every edge of the row, in order
+        if (node >= rows()) return;
+        if (!compacted()) visitRow<RowKind::Plain>(node, visit);
+        else if (uniform_rows[node]) visitRow<RowKind::Uniform>(node, visit);
+        else visitRow<RowKind::Mixed>(node, visit);
+    }
+
+    void compact() {
+        if (compacted()) return;
+        int n = rows();
+        for (int64_t edge = 0; edge < edges(); edge++) {
+            // the weight of an edge to a node without a row could not be found
+            if (neighbors[edge] < 0 || neighbors[edge] >= n) return;
+        }
+        uniform_rows.assign(n, 0);
+        row_weights.assign(n, 0);
+        for (int node = 0; node < n; node++) {
+            if (offsets[node] == offsets[node + 1]) continue;
+            float weight = weights[offsets[node]];
+            bool uniform = true;
+            for (int64_t edge = offsets[node] + 1; edge < offsets[node + 1] && uniform; edge++) {
+                uniform = weights[edge] == weight;
+            }
+            uniform_rows[node] = uniform;
+            row_weights[node] = weight;
+        }
+        // an edge into a uniform row only goes without its weight if it
+        // weighs what the row does, otherwise the row keeps its weights
+        bool demoted = true;
+        while (demoted) {
+            demoted = false;
+            for (int node = 0; node < n; node++) {
+                if (uniform_rows[node]) continue;
+                for (int64_t edge = offsets[node]; edge < offsets[node + 1]; edge++) {
+                    int neighbor = neighbors[edge];
+                    if (uniform_rows[neighbor] && weights[edge] != row_weights[neighbor]) {
+                        uniform_rows[neighbor] = 0;
+                        demoted = true;
+                    }
+                }
+            }
+        }
+        weight_offsets.assign(n + 1, 0);
+        for (int node = 0; node < n; node++) {
+            weight_offsets[node + 1] = weight_offsets[node];
+            if (uniform_rows[node]) continue;
+            for (int64_t edge = offsets[node]; edge < offsets[node + 1]; edge++) {
+                if (!uniform_rows[neighbors[edge]]) weight_offsets[node + 1]++;
+            }
+        }
+        ScratchVector<float> kept(weight_offsets[n], 0, weights.get_allocator());
+        for (int node = 0; node < n; node++) {
+            if (uniform_rows[node]) continue;
+            int64_t next = weight_offsets[node];
+            for (int64_t edge = offsets[node]; edge < offsets[node + 1]; edge++) {
+                if (!uniform_rows[neighbors[edge]]) kept[next++] = weights[edge];
+            }
+        }
+        weights.swap(kept);
+    }
+    void expand() {
+        // back to a weight for every edge
+        if (!compacted()) return;
+        ScratchVector<float> all(weights.get_allocator());
+        all.reserve(edges());
+        for (int node = 0; node < rows(); node++) {
+            forEachEdge(node, [&all](int, float weight) { all.push_back(weight); });
+        }
+        weights.swap(all);
+        weight_offsets = std::vector<int64_t>();
+        row_weights = std::vector<float>();
+        uniform_rows = std::vector<char>();
+    }
+    int64_t removeLightEdges(float epsilon) {
+        // drops every edge of weight at most epsilon in place and returns
+        // how many went, rows keep their order
+        bool was_compacted = compacted();
+        expand();
+        int64_t kept = 0;
+        int64_t row_begin = 0;
+        for (int node = 0; node < rows(); node++) {
+            int64_t row_end = offsets[node + 1];
+            offsets[node] = kept;
+            for (int64_t edge = row_begin; edge < row_end; edge++) {
+                if (weights[edge] <= epsilon) continue;
+                neighbors[kept] = neighbors[edge];
+                weights[kept] = weights[edge];
+                kept++;
+            }
+            row_begin = row_end;
+        }
+        int64_t removed = edges() - kept;
+        if (!offsets.empty()) offsets[rows()] = kept;
+        neighbors.resize(kept);
+        weights.resize(kept);
+        if (was_compacted) compact();
+        return removed;
+    }
+    void clear() {
+        offsets = std::vector<int64_t>();
+        neighbors = ScratchVector<int>();
+        weights = ScratchVector<float>();
+        weight_offsets = std::vector<int64_t>();
+        row_weights = std::vector<float>();
+        uniform_rows = std::vector<char>();
+    }
+};
+}
@@ -0,0 +1,347 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "estimate.hpp"
+#include "inputstream.hpp"
+#include "snapshot.hpp"
+#include "mrf/min_closure.hpp"
+#include <sys/stat.h>
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+
+namespace mrfsat {
+
+// read size of the counting pass
+static const size_t COUNT_BUFFER_SIZE = 1 << 16;
+// buffer of a streamed parse, as in the lexer
+static const int64_t STREAM_BUFFER_BYTES = 1 << 22;
+// resident size of the program before any instance is read
+static const int64_t BASELINE_BYTES = 4 << 20;
+
+static int64_t mallocBytes(int64_t size) {
+    // glibc chunks carry a size word and are 16 byte aligned
+    return size == 0 ? 0 : std::max<int64_t>(32, (size + 8 + 15) & ~(int64_t)15);
+}
+
+static int64_t grownBytes(int64_t elements, int64_t element_size) {
+    // vectors grown one element at a time end at the next power of two
+    return elements == 0 ? 0 : mallocBytes((int64_t)std::bit_ceil((uint64_t)elements) * element_size);
+}
+
+static int64_t setNodeBytes() {
+    // node and bucket of an unordered_set<int> entry
+    return mallocBytes(sizeof(void*) + sizeof(int) + sizeof(size_t)) + (int64_t)sizeof(void*);
+}
+
+namespace {
+class InstanceCounter {
+    /*
+        Line by line count of an OPB or DIMACS CNF instance, following the
+        grammar of the parsers closely enough to number variables and
+        constraints the same way, but without checking it.
+    */
+    public:
+        explicit InstanceCounter(InstanceCounts& counts) : counts(counts) {}
+        void countLine(const char* begin, const char* end);
+        void finish();
+        bool stopped = false;
+    private:
+        void countOPBLine(const char* cursor, const char* end);
+        void countCNFLine(const char* cursor, const char* end);
+        void addConstraint(int64_t terms, bool is_equality);
+        void addVariable(int64_t variable) {counts.variables = std::max(counts.variables, variable);}
+        static int64_t headerField(const char* begin, const char* end, const char* field);
+        InstanceCounts& counts;
+        bool first_line = true;
+        int64_t open_terms = 0;
+};
+
+void InstanceCounter::countLine(const char* cursor, const char* end) {
+    while (cursor < end && std::isspace(static_cast<unsigned char>(*cursor))) ++cursor;
+    if (cursor == end) return;
+    if (counts.format == "cnf") {
+        countCNFLine(cursor, end);
+    } else {
+        countOPBLine(cursor, end);
+    }
+    first_line = false;
+}
+
+void InstanceCounter::countOPBLine(const char* cursor, const char* end) {
+    if (*cursor == '*') {
+        if (first_line) {
+            counts.declared_constraints = std::max<int64_t>(headerField(cursor, end, "#constraint="), 0);
+        }
+        return;
+    }
+    if (*cursor == 'm') {
+        // objective
+        return;
+    }
+    // every "x" starts a term, and a "=" not after ">" makes an equality
+    int64_t terms = 0;
+    bool is_equality = false;
+    char previous = '\0';
+    for (; cursor < end && *cursor != ';'; ++cursor) {
+        char c = *cursor;
+        if (c == 'x') {
+            int64_t variable = 0;
+            while (cursor + 1 < end && static_cast<unsigned char>(cursor[1] - '0') < 10) {
+                variable = variable * 10 + (*++cursor - '0');
+            }
+            addVariable(variable);
+            terms++;
+        } else if (c == '=') {
+            is_equality = previous != '>';
+        }
+        if (c != ' ' && c != '\t') previous = c;
+    }
+    addConstraint(terms, is_equality);
+}
+
+void InstanceCounter::countCNFLine(const char* cursor, const char* end) {
+    if (*cursor == 'c') {
+        return;
+    } else if (*cursor == 'p') {
+        const char* position = cursor + 1;
+        while (position < end && !std::isdigit(static_cast<unsigned char>(*position))) ++position;
+        while (position < end && std::isdigit(static_cast<unsigned char>(*position))) ++position;
+        counts.declared_constraints = std::max<long>(std::strtol(position, nullptr, 10), 0);
+        return;
+    } else if (*cursor == '%') {
+        stopped = true;
+        return;
+    }
+    // a clause ends at its 0 and may span lines
+    while (cursor < end) {
+        if (*cursor == '-') ++cursor;
+        if (cursor == end || !std::isdigit(static_cast<unsigned char>(*cursor))) {
+            ++cursor;
+            continue;
+        }
+        int64_t literal = 0;
+        while (cursor < end && std::isdigit(static_cast<unsigned char>(*cursor))) {
+            literal = literal * 10 + (*cursor++ - '0');
+        }
+        if (literal == 0) {
+            addConstraint(open_terms, false);
+            open_terms = 0;
+        } else {
+            addVariable(literal);
+            open_terms++;
+        }
+    }
+}
+
+void InstanceCounter::addConstraint(int64_t terms, bool is_equality) {
+    counts.constraints++;
+    counts.terms += terms;
+    counts.term_bytes += grownBytes(terms, sizeof(std::pair<int, int>));
+    if (is_equality) {
+        counts.equalities++;
+        counts.equality_terms += terms;
+    }
+}
+
+void InstanceCounter::finish() {
+    if (open_terms > 0) {
+        // the last clause may omit its terminating 0
+        addConstraint(open_terms, false);
+        open_terms = 0;
+    }
+}
+
+int64_t InstanceCounter::headerField(const char* begin, const char* end, const char* field) {
+    size_t field_length = std::strlen(field);
+    for (const char* position = begin; position + field_length <= end; ++position) {
+        if (std::memcmp(position, field, field_length) == 0) {
+            return std::strtol(position + field_length, nullptr, 10);
+        }
+    }
+    return -1;
+}
+}
+
+InstanceCounts countInstance(const std::string& file_name) {
+    InputStream stream;
+    if (!stream.open(file_name)) {
+        throw std::runtime_error("Failed to open the file.");
+    }
+    InstanceCounts counts;
+    struct stat file_stat;
+    if (!stream.isStdin() && stat(file_name.c_str(), &file_stat) == 0) {
+        counts.file_bytes = file_stat.st_size;
+    }
+    counts.streamed = stream.isStdin() || stream.compression() != InputStream::Compression::None;
+
+    std::string head = stream.peek(std::max(sizeof(SnapshotHeader), (size_t)4096));
+    if (isSnapshot(head.data(), head.size())) {
+        SnapshotHeader header = {};
+        std::memcpy(&header, head.data(), std::min(head.size(), sizeof(header)));
+        counts.format = "snapshot";
+        counts.snapshot = true;
+        counts.variables = header.n_lits / 2;
+        counts.constraints = header.n_constraints;
+        counts.rows = header.n_rows;
+        counts.edges = header.n_edges;
+        if (header.version == SNAPSHOT_VERSION && header.encoding == (uint32_t)Encoding::Variable) {
+            counts.snapshot_encoding = Encoding::Variable;
+        }
+        if (counts.streamed) {
+            // a streamed snapshot is read whole before it is loaded
+            char buffer[COUNT_BUFFER_SIZE];
+            size_t n;
+            counts.file_bytes = 0;
+            while ((n = stream.read(buffer, sizeof(buffer))) > 0) counts.file_bytes += n;
+        }
+        return counts;
+    }
+    size_t first = 0;
+    while (first < head.size() && std::isspace(static_cast<unsigned char>(head[first]))) ++first;
+    counts.format = first < head.size() && (head[first] == 'c' || head[first] == 'p') ? "cnf" : "opb";
+
+    InstanceCounter counter(counts);
+    std::vector<char> buffer(COUNT_BUFFER_SIZE);
+    std::string line;
+    size_t n;
+    while (!counter.stopped && (n = stream.read(buffer.data(), buffer.size())) > 0) {
+        const char* cursor = buffer.data();
+        const char* end = cursor + n;
+        while (cursor < end && !counter.stopped) {
+            const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+            if (!newline) {
+                line.append(cursor, end);
+                break;
+            }
+            if (line.empty()) {
+                counter.countLine(cursor, newline);
+            } else {
+                line.append(cursor, newline);
+                counter.countLine(line.data(), line.data() + line.size());
+                line.clear();
+            }
+            cursor = newline + 1;
+        }
+    }
+    if (!counter.stopped && !line.empty()) {
+        counter.countLine(line.data(), line.data() + line.size());
+    }
+    counter.finish();
+    return counts;
+}
+
+FootprintEstimate estimateFootprint(const InstanceCounts& counts, Encoding encoding, int threads,
+                                    int64_t memory_budget) {
+    FootprintEstimate estimate;
+    if (counts.snapshot) encoding = counts.snapshot_encoding;
+    int64_t variables = counts.variables;
+    int64_t literal_nodes = encoding == Encoding::Variable ? variables : 2 * variables;
+    int64_t constraints = counts.constraints;
+    int64_t int_bytes = sizeof(int);
+    int64_t float_bytes = sizeof(float);
+    int64_t offset_bytes = sizeof(int64_t);
+
+    // Parse: the input, the terms by constraint and the tables by
+    // constraint id. Parallel parsing also holds a copy of every term of
+    // the file until the chunks are merged.
+    int64_t community_bytes = (2 * variables + constraints) * int_bytes;
+    int64_t input_bytes = counts.file_bytes + (counts.streamed ? STREAM_BUFFER_BYTES : 0);
+    int64_t table_bytes = std::max(counts.declared_constraints, constraints) + 1;
+    if (counts.declared_constraints < constraints) {
+        table_bytes = (int64_t)std::bit_ceil((uint64_t)table_bytes);
+    }
+    table_bytes *= (int64_t)sizeof(ConstraintTerms) + int_bytes + 1;
+    if (counts.snapshot) {
+        estimate.nodes = literal_nodes + constraints;
+        estimate.edges = counts.edges;
+        int64_t rows = counts.rows;
+        int64_t graph_bytes = (rows + 1) * offset_bytes + estimate.edges * (int_bytes + float_bytes);
+        estimate.parse_bytes = input_bytes + graph_bytes;
+        estimate.graph_bytes = graph_bytes + rows * (offset_bytes + float_bytes + 1);
+    } else {
+        int64_t parallel_bytes = threads > 1 ? counts.terms * (int64_t)sizeof(std::pair<int, int>) : 0;
+        estimate.parse_bytes = input_bytes + counts.term_bytes + table_bytes + community_bytes + parallel_bytes;
+
+        // Build: the edge arrays are allocated while every term is still
+        // there, then compacted with the row tables beside them.
+        estimate.nodes = literal_nodes + constraints + counts.equalities;
+        estimate.edges = 2 * counts.terms + 2 * counts.equality_terms;
+        int64_t rows = estimate.nodes + 1;
+        int64_t order_bytes = counts.constraints * (setNodeBytes() + int_bytes);
+        int64_t filled = counts.term_bytes + table_bytes + order_bytes + (rows + 1) * offset_bytes +
+                         estimate.edges * (int_bytes + float_bytes);
+        int64_t compacted = table_bytes + (rows + 1) * offset_bytes + rows * (offset_bytes + float_bytes + 1) +
+                            estimate.edges * (int_bytes + 2 * float_bytes);
+        estimate.graph_bytes = community_bytes + std::max(filled, compacted);
+    }
+
+    // Solve: the graph with every weight stored, the per node vectors of
+    // the solve, the copy of the component and its network.
+    int64_t nodes = estimate.nodes;
+    int64_t edges = estimate.edges;
+    estimate.params = 2 * variables;
+    estimate.network_bytes = networkBytes(nodes, edges, estimate.params);
+    int64_t graph_bytes = (nodes + 2) * (2 * offset_bytes + float_bytes + 1) + edges * (int_bytes + float_bytes);
+    int64_t node_bytes = nodes * (13 * int_bytes + 2 * float_bytes + 2) + estimate.params * float_bytes;
+    int64_t component_bytes = graph_bytes + edges * float_bytes + nodes * (2 * float_bytes + int_bytes);
+    estimate.solve_bytes = community_bytes + graph_bytes + node_bytes + component_bytes + estimate.network_bytes;
+
+    estimate.peak_bytes = BASELINE_BYTES +
+        std::max({estimate.parse_bytes, estimate.graph_bytes, estimate.solve_bytes});
+    int64_t edge_bytes = edges * (int_bytes + float_bytes);
+    estimate.out_of_core = memory_budget > 0 && edge_bytes + estimate.network_bytes > memory_budget;
+    return estimate;
+}
+
+void writeEstimateJson(std::ostream& out, const std::string& file_name, const InstanceCounts& counts,
+                       const FootprintEstimate& estimate, Encoding encoding, int64_t memory_budget) {
+    std::string name;
+    for (char c: file_name) {
+        if (c == '"' || c == '\\') {
+            name += '\\';
+            name += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            name += escaped;
+        } else {
+            name += c;
+        }
+    }
+    if (counts.snapshot) encoding = counts.snapshot_encoding;
+    out << "{\"file\":\"" << name << "\",\"format\":\"" << counts.format << "\""
+        << ",\"encoding\":\"" << (encoding == Encoding::Variable ? "variable" : "literal") << "\""
+        << ",\"variables\":" << counts.variables << ",\"constraints\":" << counts.constraints
+        << ",\"equalities\":" << counts.equalities << ",\"terms\":" << counts.terms
+        << ",\"nodes\":" << estimate.nodes << ",\"edges\":" << estimate.edges
+        << ",\"params\":" << estimate.params << ",\"parse_bytes\":" << estimate.parse_bytes
+        << ",\"graph_bytes\":" << estimate.graph_bytes << ",\"network_bytes\":" << estimate.network_bytes
+        << ",\"solve_bytes\":" << estimate.solve_bytes << ",\"peak_bytes\":" << estimate.peak_bytes;
+    if (memory_budget > 0) {
+        out << ",\"memory_budget\":" << memory_budget
+            << ",\"fits_budget\":" << (estimate.peak_bytes <= memory_budget ? "true" : "false")
+            << ",\"out_of_core\":" << (estimate.out_of_core ? "true" : "false");
+    }
+    out << "}" << std::endl;
+}
+}
@@ -0,0 +1,81 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include "graph.hpp"
+
+namespace mrfsat {
+
+/*
+    Sizes of an instance taken by one pass over its input that only counts
+    tokens, without building anything: variables and constraints as the
+    parser would number them, the terms of the constraints and the share
+    of them in equalities, which get a second node. Snapshots give their
+    sizes in the header. term_bytes is what the parser keeps the terms in,
+    one vector per constraint grown by doubling.
+*/
+struct InstanceCounts {
+    std::string format;
+    int64_t file_bytes = 0;
+    bool streamed = false;
+    int64_t variables = 0;
+    int64_t declared_constraints = 0;
+    int64_t constraints = 0;
+    int64_t equalities = 0;
+    int64_t terms = 0;
+    int64_t equality_terms = 0;
+    int64_t term_bytes = 0;
+    // only known for snapshots, which also fix the encoding
+    bool snapshot = false;
+    Encoding snapshot_encoding = Encoding::Literal;
+    int64_t rows = 0;
+    int64_t edges = 0;
+};
+
+/*
+    Predicted peak memory of each phase of the analysis of an instance,
+    in bytes. Edges are counted before repeated literals are merged and
+    light edges dropped, and the flow network is the one of a graph that
+    is a single component, so the figures are upper bounds rather than
+    expectations. out_of_core tells whether the given memory budget would
+    make the build keep the edges and networks in scratch files.
+*/
+struct FootprintEstimate {
+    int64_t nodes = 0;
+    int64_t edges = 0;
+    int64_t params = 0;
+    int64_t parse_bytes = 0;
+    int64_t graph_bytes = 0;
+    int64_t network_bytes = 0;
+    int64_t solve_bytes = 0;
+    int64_t peak_bytes = 0;
+    bool out_of_core = false;
+};
+
+// throws std::runtime_error when the file can not be read
+InstanceCounts countInstance(const std::string& file_name);
+
+FootprintEstimate estimateFootprint(const InstanceCounts& counts, Encoding encoding, int threads,
+                                    int64_t memory_budget);
+
+// one line JSON object, with the budget fields only for a budget above 0
+void writeEstimateJson(std::ostream& out, const std::string& file_name, const InstanceCounts& counts,
+                       const FootprintEstimate& estimate, Encoding encoding, int64_t memory_budget);
+}
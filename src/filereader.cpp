@@ -17,37 +17,85 @@
 
 #include "filereader.hpp"
 #include "parsers/opbparser.hpp"
+#include "parsers/cnfparser.hpp"
+#include "mappedfile.hpp"
+#include "inputstream.hpp"
+#include "snapshot.hpp"
+#include <cctype>
+#include <vector>
 
 
 namespace mrfsat {
 
-std::string FileReader::getFileExtension(const std::string &file_name) {
-    size_t pos = file_name.find_last_of('.');
-    if (pos == std::string::npos) {
-        return "";
+// bytes of a streamed input looked at to tell OPB from DIMACS CNF
+static const size_t FORMAT_PEEK_SIZE = 4096;
+
+bool FileReader::parseFile(std::string file_name) {
+    // plain files are parsed straight from their mapping, which also
+    // shows whether they are compressed; stdin and compressed files are
+    // streamed
+    if (file_name != "-") {
+        MappedFile file;
+        if (!file.open(file_name)) {
+            std::cerr << "Failed to open the file." << std::endl;
+            return false;
+        }
+        if (InputStream::detectCompression(file.begin(), file.size()) == InputStream::Compression::None) {
+            parseContents(file.begin(), file.end());
+            return true;
+        }
+    }
+    InputStream stream;
+    if (!stream.open(file_name)) {
+        std::cerr << "Failed to open the file." << std::endl;
+        return false;
     }
-    return file_name.substr(pos + 1);
+    parseStreamedFile(stream);
+    return true;
 }
 
-void FileReader::parseFile(std::string file_name) {
-    if (getFileExtension(file_name) == "opb") {
-        parseOPBFile(file_name);
+std::unique_ptr<Lexer> FileReader::makeParser(const char* begin, const char* end) {
+    // DIMACS files open with "c" comments or the "p cnf" header, OPB files
+    // with "*" comments, an objective or a term
+    const char* first = begin;
+    while (first < end && std::isspace(static_cast<unsigned char>(*first))) ++first;
+    std::unique_ptr<Lexer> parser;
+    if (first < end && (*first == 'c' || *first == 'p')) {
+        parser = std::make_unique<CNFParser>(graph);
     } else {
-        std::cout << "Error: File extension not supported." << std::endl;
-        return;
+        parser = std::make_unique<OPBParser>(graph);
     }
-    return;
+    parser->setThreads(threads);
+    return parser;
 }
 
-void FileReader::parseOPBFile(std::string file_name) {
-    std::string line_stream;
-    std::ifstream file_stream(file_name);
-    if (!file_stream.is_open()) {
-        std::cerr << "Failed to open the file." << std::endl;
+bool FileReader::parseContents(const char* begin, const char* end) {
+    // whole uncompressed file already in memory, compressed data is
+    // refused and has to go through parseFile
+    if (InputStream::detectCompression(begin, end - begin) != InputStream::Compression::None) {
+        return false;
+    }
+    if (isSnapshot(begin, end - begin)) {
+        graph.loadSnapshot(begin, end);
+        return true;
+    }
+    makeParser(begin, end)->parseBuffer(begin, end);
+    return true;
+}
+
+void FileReader::parseStreamedFile(InputStream& stream) {
+    std::string head = stream.peek(FORMAT_PEEK_SIZE);
+    if (isSnapshot(head.data(), head.size())) {
+        std::vector<char> snapshot;
+        char buffer[1 << 16];
+        size_t n;
+        while ((n = stream.read(buffer, sizeof(buffer))) > 0) {
+            snapshot.insert(snapshot.end(), buffer, buffer + n);
+        }
+        graph.loadSnapshot(snapshot.data(), snapshot.data() + snapshot.size());
         return;
     }
-    OPBParser parser(graph);
-    parser.parseFile(file_stream);
+    makeParser(head.data(), head.data() + head.size())->parseStream(stream);
     return;
 }
 }
@@ -19,15 +19,27 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <memory>
 #include "graph.hpp"
+#include "inputstream.hpp"
+#include "parsers/lexer.hpp"
 
 namespace mrfsat {
 class FileReader {
     public:
-        void parseFile(std::string file_name);
+        FileReader() {
+            threads = 1;
+        }
+        bool parseFile(std::string file_name);
+        bool parseContents(const char* begin, const char* end);
+        void setThreads(int n_threads) {
+            threads = n_threads;
+            graph.setThreads(n_threads);
+        }
         Graph graph;
     private:
-        void parseOPBFile(std::string file_name);
-        std::string getFileExtension(const std::string& filename);
+        int threads;
+        std::unique_ptr<Lexer> makeParser(const char* begin, const char* end);
+        void parseStreamedFile(InputStream& stream);
 };
 }
\ No newline at end of file
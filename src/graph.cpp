@@ -16,29 +16,61 @@
 */
 
 #include "graph.hpp"
+#include "coarsen.hpp"
 #include "mrf/min_closure.hpp"
+#include <atomic>
+#include <exception>
+#include <thread>
 
 
 namespace mrfsat {
+    void Graph::reserve(int declared_variables, int declared_constraints) {
+        // sizes come from the instance header and are only a hint, a
+        // wrong header just means the tables grow as they would without it
+        if (declared_constraints > 0) {
+            constraint_terms.reserve((size_t)declared_constraints + 1);
+            constraint_coefficients.reserve((size_t)declared_constraints + 1);
+            normalization_marks.reserve((size_t)declared_constraints + 1);
+        }
+        if (declared_variables > 0) {
+            community_nodes.reserve(2 * (size_t)declared_variables + std::max(declared_constraints, 0));
+        }
+    }
+
     void Graph::addVariableToConstraint(int constraint_id, std::pair<int, int> variable_data) {
-        adjacency_list[constraint_id][variable_data.first] = variable_data.second;
+        if (constraint_id < 0) throw std::runtime_error("Negative constraint id");
+        if ((size_t)constraint_id >= constraint_terms.size()) {
+            constraint_terms.resize((size_t)constraint_id + 1);
+        }
+        // a literal repeated in a constraint is merged when the graph is built
+        constraint_terms[constraint_id].push_back(variable_data);
     }
 
     void Graph::addConstraintCoefficient(int constraint_id, int constraint_coefficient) {
+        if (constraint_id < 0) throw std::runtime_error("Negative constraint id");
+        if ((size_t)constraint_id >= constraint_coefficients.size()) {
+            constraint_coefficients.resize((size_t)constraint_id + 1, 0);
+        }
         constraint_coefficients[constraint_id] = constraint_coefficient;
     }
 
-    void Graph::updateAdjacencyList(std::unordered_map<int, NodeMap>& new_adjacency_list, int graph_node, int constraint_node, int value, int divisor, bool isEqualized) {
-        if (divisor != 0) {
-            new_adjacency_list[graph_node][constraint_node + n_lits + (isEqualized ? to_normalize_amount : 0)] = std::abs(value / divisor);
-            new_adjacency_list[constraint_node + n_lits + (isEqualized ? to_normalize_amount : 0)][graph_node] = std::abs(value / divisor);
-        } else {
-            new_adjacency_list[graph_node][constraint_node + n_lits] = std::abs((value + 1) / (divisor + 1));
-            new_adjacency_list[constraint_node + n_lits][graph_node] = std::abs((value + 1) / (divisor + 1));
-        }
+    int Graph::constraintCoefficient(int constraint_id) const {
+        if (constraint_id < 0 || (size_t)constraint_id >= constraint_coefficients.size()) return 0;
+        return constraint_coefficients[constraint_id];
+    }
+
+    bool Graph::isEqualized(int constraint_id) const {
+        return (size_t)constraint_id < normalization_marks.size() && normalization_marks[constraint_id];
+    }
+
+    int Graph::literalNodes() const {
+        return encoding == Encoding::Variable ? n_lits / 2 : n_lits;
     }
 
     int Graph::getGraphNode(int lit_node) {
+        if (encoding == Encoding::Variable) {
+            return std::abs(lit_node);
+        }
         if (lit_node < 0) {
             return -1 * lit_node + n_lits / 2;
         } else {
@@ -46,81 +78,516 @@ namespace mrfsat {
         }
     }
 
-    void Graph::buildFromConstraints() {
-        std::unordered_map<int, NodeMap> new_adjacency_list;
+    std::vector<int> Graph::constraintOrder() {
+        // The second node of an equality constraint is numbered from
+        // to_normalize_amount, which counts down as constraints are visited,
+        // so the visiting order is part of the graph. That order has always
+        // been the one of a default-sized unordered_map keyed by constraint
+        // and filled in parse order; replay it so the graph stays the same.
+        // The order, and so the node ids and the features the shipped model
+        // was trained on, depend on the hashing of the standard library the
+        // program is built with (libstdc++ hashes an int to itself).
+        std::unordered_set<int> parse_order;
+        for (int constraint_node = 0; constraint_node < (int)constraint_terms.size(); constraint_node++) {
+            if (!constraint_terms[constraint_node].empty()) parse_order.insert(constraint_node);
+        }
+        return std::vector<int>(parse_order.begin(), parse_order.end());
+    }
+
+    template <typename Visit>
+    void Graph::visitConstraint(int constraint_node, const ConstraintTerms& lit_nodes, bool equalized,
+                                int equality_offset, Visit visit) {
+        // Every literal of a constraint is joined to the constraint node
+        // with weight |coefficient / right-hand side|; equality constraints
+        // get a second node, equality_offset further on, weighted by the
+        // slack of the other direction. Edges come in both directions.
+        int literal_nodes = literalNodes();
+        int coefficient = constraintCoefficient(constraint_node);
+        auto weightOf = [](int value, int divisor) -> float {
+            if (divisor != 0) return std::abs(value / divisor);
+            return std::abs((value + 1) / (divisor + 1));
+        };
+        auto edge = [&](int graph_node, float weight, int divisor, bool isEqualized) {
+            int node;
+            if (divisor != 0) {
+                node = constraint_node + literal_nodes + (isEqualized ? equality_offset : 0);
+            } else {
+                node = constraint_node + literal_nodes;
+            }
+            visit(graph_node, node, weight);
+            visit(node, graph_node, weight);
+        };
         int normalizer = 0;
-        for (auto& [constraint_node, lit_nodes]: adjacency_list) {
-            auto it = normalization_marks.find(constraint_node);
-            bool isEqualized = it != normalization_marks.end() && it->second == 1;
-            
-            if (isEqualized) {
-                normalizer = 0;
-                for (const auto& pair : lit_nodes) {
-                    normalizer += pair.second;
-                }
-                normalizer -= constraint_coefficients[constraint_node];
-                to_normalize_amount--;
-                n_constraints += 1;
+        if (equalized) {
+            for (const auto& pair : lit_nodes) {
+                normalizer += pair.second;
             }
+            normalizer -= coefficient;
+        }
 
-            for (auto& [lit_node, value]: lit_nodes) {
-                int graph_node = getGraphNode(lit_node);
+        // In the variable encoding both literals of a variable share a
+        // node, their edges to the constraint are merged by adding the
+        // weights. The terms are ordered by variable, so they are adjacent.
+        float weight = 0;
+        float equality_weight = 0;
+        for (size_t term = 0; term < lit_nodes.size(); term++) {
+            auto [lit_node, value] = lit_nodes[term];
+            int graph_node = getGraphNode(lit_node);
 
-                if (isEqualized) {
-                    updateAdjacencyList(new_adjacency_list, graph_node, constraint_node, value, normalizer, true);
-                    updateAdjacencyList(new_adjacency_list, graph_node, constraint_node, value, constraint_coefficients[constraint_node], false);
-                }
-                else {
-                    updateAdjacencyList(new_adjacency_list, graph_node, constraint_node, value, constraint_coefficients[constraint_node], false);
-                }
+            if (equalized) {
+                equality_weight += weightOf(value, normalizer);
+            }
+            weight += weightOf(value, coefficient);
+            if (term + 1 < lit_nodes.size() && getGraphNode(lit_nodes[term + 1].first) == graph_node) continue;
+
+            if (equalized) {
+                edge(graph_node, equality_weight, normalizer, true);
+                edge(graph_node, weight, coefficient, false);
+            }
+            else {
+                edge(graph_node, weight, coefficient, false);
+            }
+            weight = 0;
+            equality_weight = 0;
+        }
+    }
+
+    template <typename Visit>
+    void Graph::visitEdges(Visit visit, bool release) {
+        // A later edge between the same pair of nodes replaces an earlier
+        // one. With release set, the terms of a constraint are freed as soon
+        // as its edges have been visited.
+        int remaining_equalities = to_normalize_amount;
+        for (int constraint_node: constraintOrder()) {
+            ConstraintTerms& lit_nodes = constraint_terms[constraint_node];
+            bool equalized = isEqualized(constraint_node);
+            if (equalized) {
+                remaining_equalities--;
+            }
+            visitConstraint(constraint_node, lit_nodes, equalized, remaining_equalities, visit);
+            if (equalized && keep_constraints) {
+                equality_offsets[constraint_node] = remaining_equalities;
+            }
+            if (release) ConstraintTerms().swap(lit_nodes);
+        }
+    }
+
+    void Graph::constraintEdges(int constraint_id, EdgeList& edges) {
+        visitConstraint(constraint_id, constraint_terms[constraint_id], isEqualized(constraint_id),
+                        equality_offsets[constraint_id], [&edges](int from, int to, float weight) {
+            edges.push_back(std::make_pair(std::make_pair(from, to), weight));
+        });
+    }
+
+    void Graph::mergeTerms(ConstraintTerms& terms) {
+        // a literal repeated in a constraint keeps its last coefficient, as
+        // the constraint maps of the parser used to, and the terms end up
+        // ordered by variable
+        if (terms.size() < 2) return;
+        std::stable_sort(terms.begin(), terms.end(),
+            [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                return std::make_pair(std::abs(a.first), a.first) < std::make_pair(std::abs(b.first), b.first);
+            });
+        size_t kept = 0;
+        for (size_t term = 0; term < terms.size(); term++) {
+            if (term + 1 < terms.size() && terms[term + 1].first == terms[term].first) continue;
+            terms[kept++] = terms[term];
+        }
+        terms.resize(kept);
+    }
+
+    void Graph::mergeRepeatedLiterals() {
+        for (ConstraintTerms& terms: constraint_terms) {
+            mergeTerms(terms);
+        }
+    }
+
+    void Graph::buildFromConstraints() {
+        if (built) {
+            // loaded from a snapshot
+            return;
+        }
+        mergeRepeatedLiterals();
+        int max_constraint = 0;
+        int equalities = 0;
+        for (int constraint_node = 0; constraint_node < (int)constraint_terms.size(); constraint_node++) {
+            if (constraint_terms[constraint_node].empty()) continue;
+            max_constraint = constraint_node;
+            if (isEqualized(constraint_node)) equalities++;
+        }
+
+        // Count, then place every edge straight into its row of the final
+        // arrays while the terms are released constraint by constraint, so
+        // the build never holds more than the terms left and the graph.
+        // Incremental graphs keep the terms to take constraints out later.
+        if (keep_constraints) equality_offsets.assign(constraint_terms.size(), 0);
+        int rows = literalNodes() + max_constraint + to_normalize_amount + 1;
+        std::vector<int64_t>& offsets = csr_graph.offsets;
+        offsets.assign(rows + 1, 0);
+        visitEdges([&](int from, int, float) {
+            offsets[from + 1]++;
+        }, false);
+        for (int node = 0; node < rows; node++) {
+            offsets[node + 1] += offsets[node];
+        }
+        // past the memory budget, the edges are kept out of core
+        int64_t edge_bytes = offsets[rows] * (int64_t)(sizeof(int) + sizeof(float));
+        int64_t network_bytes = networkBytes(literalNodes() + n_constraints + equalities, offsets[rows], n_lits);
+        csr_graph.setOutOfCore(memory_budget > 0 && edge_bytes + network_bytes > memory_budget);
+        ScratchVector<int>& neighbors = csr_graph.neighbors;
+        ScratchVector<float>& weights = csr_graph.weights;
+        neighbors.resize(offsets[rows]);
+        weights.resize(offsets[rows]);
+        // offsets[node] is the fill position of the row until shifted back
+        visitEdges([&](int from, int to, float weight) {
+            int64_t edge = offsets[from]++;
+            neighbors[edge] = to;
+            weights[edge] = weight;
+        }, !keep_constraints);
+        for (int node = rows; node > 0; node--) {
+            offsets[node] = offsets[node - 1];
+        }
+        offsets[0] = 0;
+        if (!keep_constraints) constraint_terms = std::vector<ConstraintTerms>();
+
+        // sort each row by neighbor and keep the last edge of each pair,
+        // compacting towards the front of the arrays
+        std::vector<std::pair<int, float> > row;
+        int64_t row_begin = 0;
+        int64_t kept = 0;
+        for (int node = 0; node < rows; node++) {
+            int64_t row_end = offsets[node + 1];
+            row.clear();
+            for (int64_t edge = row_begin; edge < row_end; edge++) {
+                row.emplace_back(neighbors[edge], weights[edge]);
+            }
+            std::stable_sort(row.begin(), row.end(),
+                [](const std::pair<int, float>& a, const std::pair<int, float>& b) { return a.first < b.first; });
+            offsets[node] = kept;
+            for (size_t edge = 0; edge < row.size(); edge++) {
+                if (edge + 1 < row.size() && row[edge + 1].first == row[edge].first) continue;
+                neighbors[kept] = row[edge].first;
+                weights[kept] = row[edge].second;
+                kept++;
             }
+            row_begin = row_end;
         }
+        offsets[rows] = kept;
+        // repeated edges are rare, the few slots they leave are not worth
+        // a copy of the arrays to give back
+        neighbors.resize(kept);
+        weights.resize(kept);
+        // most constraints have a single coefficient, and their edges a
+        // single weight
+        csr_graph.compact();
 
-        adjacency_list = std::move(new_adjacency_list);
+        to_normalize_amount -= equalities;
+        n_constraints += equalities;
+        built = true;
+    }
+
+    int64_t Graph::sparsify(float epsilon) {
+        // Weights come from an integer division, so every coefficient below
+        // its right-hand side gives an edge of weight 0. Its arcs could never
+        // carry flow and only lengthen the scans of the solver.
+        if (epsilon < 0) return 0;
+        sparsify_epsilon = epsilon;
+        return csr_graph.removeLightEdges(epsilon);
     }
 
     void Graph::updateLiteralsAmount(int new_number) {
         n_lits = std::max(n_lits, new_number);
     }
 
+    static int findComponent(std::vector<int>& parent, int node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
     void Graph::calculateMRFClusters() {
-        numNodes = 0;
-        numArcs = 0;
-        source = 0;
-        sink = 0;
-        numParams = n_lits;
-        highestStrongLabel = 1;
+        normalization_size = n_constraints + literalNodes();
+        solveBreakpoints(false);
+        collectClusters();
+    }
+
+    void Graph::solveBreakpoints(bool warm) {
         int n_var = n_lits / 2;
-        adjacencyList = NULL;
-        strongRoots = NULL;
-        labelCount = NULL;
-        arcList = NULL;
-        int nodes_amount = n_constraints + n_lits;
-        graphInput(adjacency_list, nodes_amount, n_var);
-        simpleInitialization();
-        pseudoflowPhase1();
-        for (int l = 0; l < numNodes; l++) {
-            int cluster = adjacencyList[l].breakpoint;
-            if (l == n_lits) std::cout << clusters.size() << ",";
+        int literal_nodes = literalNodes();
+        int nodes_amount = n_constraints + literal_nodes;
+        std::vector<float> source_values, sink_values, lambda_values;
+        terminalValues(csr_graph, nodes_amount, n_var, literal_nodes, source_values, sink_values, normalization_size);
+        parameterValues(normalization_size, n_var, n_lits, lambda_values);
+
+        // A warm solve keeps the breakpoint of every node whose component
+        // has the same edges and arc capacities as in the previous solve.
+        dirty_nodes.resize(nodes_amount + 1, 1);
+        for (int node = 1; node <= nodes_amount; node++) {
+            if (!warm || node >= (int)solved_source.size() || solved_source[node] != source_values[node] ||
+                solved_sink[node] != sink_values[node]) {
+                dirty_nodes[node] = 1;
+            }
+        }
+        solved_source = std::move(source_values);
+        solved_sink = std::move(sink_values);
+        breakpoints.resize(nodes_amount + 2);
+        if (coarsen_levels > 0 && !warm) {
+            solveCoarsened(nodes_amount, lambda_values);
+        } else {
+            solved_nodes = solveNetwork(csr_graph, nodes_amount, solved_source, solved_sink, lambda_values,
+                                        dirty_nodes, !warm, breakpoints);
+        }
+        // the source and the sink come last, as in a single network
+        breakpoints[nodes_amount] = 0;
+        breakpoints[nodes_amount + 1] = n_lits + 2;
+        dirty_nodes.assign(nodes_amount + 1, 0);
+    }
+
+    void Graph::solveCoarsened(int nodes_amount, const std::vector<float>& lambda_values) {
+        // Solves a graph coarsened coarsen_levels times, or until no two
+        // nodes can be matched, and gives every node the breakpoint of the
+        // coarse node it ended up in. A node keeps it only if no parameter
+        // value lies between its source value and the coarse node's and its
+        // source and sink compare the same way: with the inner arcs carrying
+        // no flow, that is the breakpoint it would get solved on its own.
+        // The other nodes are solved again in the full graph.
+        std::vector<CoarseLevel> levels;
+        levels.reserve(coarsen_levels);
+        const CSRGraph* finer = &csr_graph;
+        int nodes = nodes_amount;
+        std::vector<int> single(nodes_amount + 1, 1);
+        const std::vector<int>* members = &single;
+        const std::vector<float>* source_values = &solved_source;
+        const std::vector<float>* sink_values = &solved_sink;
+        for (int level = 0; level < coarsen_levels; level++) {
+            CoarseLevel next = coarsenGraph(*finer, nodes, *members, *source_values, *sink_values);
+            if (next.nodes == nodes) break;
+            levels.push_back(std::move(next));
+            CoarseLevel& coarse = levels.back();
+            finer = &coarse.graph;
+            nodes = coarse.nodes;
+            members = &coarse.members;
+            source_values = &coarse.source_values;
+            sink_values = &coarse.sink_values;
+        }
+        std::vector<int> coarse_breakpoints(nodes + 2);
+        std::vector<char> every_node(nodes + 1, 1);
+        solved_nodes = solveNetwork(*finer, nodes, *source_values, *sink_values, lambda_values, every_node, true,
+                                    coarse_breakpoints);
+        coarse_nodes = nodes;
+
+        auto crossings = [&lambda_values](float value) {
+            return std::make_pair(std::lower_bound(lambda_values.begin(), lambda_values.end(), value),
+                                  std::upper_bound(lambda_values.begin(), lambda_values.end(), value));
+        };
+        auto compare = [](float source, float sink) { return (source > sink) - (source < sink); };
+        std::vector<char> unsettled(nodes_amount + 1, 0);
+        for (int node = 1; node <= nodes_amount; node++) {
+            int coarse = node;
+            for (const CoarseLevel& level: levels) {
+                coarse = level.coarse_of[coarse];
+            }
+            breakpoints[node - 1] = coarse_breakpoints[coarse - 1];
+            if (crossings(solved_source[node]) != crossings((*source_values)[coarse]) ||
+                compare(solved_source[node], solved_sink[node]) != compare((*source_values)[coarse], (*sink_values)[coarse])) {
+                unsettled[node] = 1;
+            }
+        }
+        levels = std::vector<CoarseLevel>();
+        refined_nodes = solveNetwork(csr_graph, nodes_amount, solved_source, solved_sink, lambda_values, unsettled,
+                                     false, breakpoints);
+        solved_nodes += refined_nodes;
+    }
+
+    int64_t Graph::solveNetwork(const CSRGraph& graph, int nodes_amount, const std::vector<float>& source_values,
+                                const std::vector<float>& sink_values, const std::vector<float>& lambda_values,
+                                const std::vector<char>& dirty, bool whole_components, std::vector<int>& solved) {
+        // Solves the dirty nodes among 1 .. nodes_amount of graph and
+        // writes the breakpoint of node i to solved[i - 1]; returns how many
+        // nodes were solved.
+        auto inRange = [nodes_amount](int node) { return node >= 1 && node <= nodes_amount; };
+
+        // Nodes only meet through the source and the sink otherwise, so the
+        // network splits into its connected components without changing a
+        // breakpoint. Small components are batched in order of their first
+        // node so that every solve has some work in it.
+        //
+        // The arcs between nodes have no capacity at any parameter, so a
+        // breakpoint depends on the source and sink arcs of its node alone.
+        // Without whole_components, just the dirty nodes are batched and the
+        // edges that leave a batch are dropped.
+        std::vector<int> parent(nodes_amount + 1);
+        std::iota(parent.begin(), parent.end(), 0);
+        if (whole_components) {
+            for (int node = 1; node <= nodes_amount; node++) {
+                for (int64_t edge = graph.begin(node); edge < graph.end(node); edge++) {
+                    int neighbor = graph.neighbors[edge];
+                    if (!inRange(neighbor)) continue;
+                    int a = findComponent(parent, node);
+                    int b = findComponent(parent, neighbor);
+                    if (a != b) parent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+        std::vector<int> component_size(nodes_amount + 1, 0);
+        std::vector<char> component_dirty(nodes_amount + 1, 0);
+        for (int node = 1; node <= nodes_amount; node++) {
+            int root = findComponent(parent, node);
+            component_size[root]++;
+            if (dirty[node]) component_dirty[root] = 1;
+        }
+        std::vector<int> batch_of(nodes_amount + 1, -1);
+        std::vector<int> batch_offsets(1, 0);
+        for (int node = 1; node <= nodes_amount; node++) {
+            int root = findComponent(parent, node);
+            if (root != node) {
+                batch_of[node] = batch_of[root];
+                continue;
+            }
+            if (!component_dirty[root]) continue;
+            if (batch_offsets.size() == 1 || batch_offsets.back() - batch_offsets[batch_offsets.size() - 2] >= MIN_BATCH_NODES) {
+                batch_offsets.push_back(batch_offsets.back());
+            }
+            batch_offsets.back() += component_size[root];
+            batch_of[node] = batch_offsets.size() - 2;
+        }
+        component_size = std::vector<int>();
+        component_dirty = std::vector<char>();
+        // nodes of each batch by id, and their number inside the batch
+        std::vector<int> batch_nodes(batch_offsets.back());
+        std::vector<int> local_node(nodes_amount + 1, 0);
+        std::vector<int> filled(batch_offsets.begin(), batch_offsets.end() - 1);
+        for (int node = 1; node <= nodes_amount; node++) {
+            int batch = batch_of[node];
+            if (batch < 0) continue;
+            local_node[node] = filled[batch] - batch_offsets[batch] + 1;
+            batch_nodes[filled[batch]++] = node;
+        }
+        parent = std::vector<int>();
+        filled = std::vector<int>();
+
+        size_t batches = batch_offsets.size() - 1;
+        size_t workers = std::min<size_t>(std::max(threads, 1), batches);
+        // past the memory budget, the networks solved side by side keep
+        // their edges and arcs out of core
+        int64_t resident = graph.outOfCore() ? 0 : graph.edges() * (int64_t)(sizeof(int) + sizeof(float));
+        std::atomic<int64_t> out_of_core_nodes(0);
+        std::atomic<int64_t> swept(0);
+
+        // every worker reuses one solver, and its arena, for all its batches
+        auto solveBatch = [&](size_t batch, PseudoflowSolver& solver) {
+            const int* nodes = batch_nodes.data() + batch_offsets[batch];
+            int size = batch_offsets[batch + 1] - batch_offsets[batch];
+            int64_t batch_edges = 0;
+            for (int local = 0; local < size; local++) {
+                batch_edges += graph.end(nodes[local]) - graph.begin(nodes[local]);
+            }
+            bool out_of_core = memory_budget > 0 &&
+                               resident + (int64_t)workers * networkBytes(size, batch_edges, n_lits) > memory_budget;
+            if (out_of_core) out_of_core_nodes += size;
+            CSRGraph component;
+            component.setOutOfCore(out_of_core);
+            std::vector<float> component_source(size + 1, 0), component_sink(size + 1, 0);
+            component.offsets.assign(size + 2, 0);
+            for (int local = 1; local <= size; local++) {
+                int node = nodes[local - 1];
+                graph.forEachEdge(node, [&](int neighbor, float weight) {
+                    if (!inRange(neighbor) || batch_of[neighbor] != (int)batch) return;
+                    component.neighbors.push_back(local_node[neighbor]);
+                    component.weights.push_back(weight);
+                });
+                component.offsets[local + 1] = component.neighbors.size();
+                component_source[local] = source_values[node];
+                component_sink[local] = sink_values[node];
+            }
+            std::vector<int> global_node(nodes, nodes + size);
+            if (ordering != NodeOrdering::Identity) {
+                // lay nodes that share arcs out next to each other
+                std::vector<int> order = nodeOrder(component, ordering);
+                component = renumberNodes(component, order);
+                std::vector<float> ordered_source(size + 1, 0), ordered_sink(size + 1, 0);
+                for (int local = 1; local <= size; local++) {
+                    global_node[local - 1] = nodes[order[local - 1] - 1];
+                    ordered_source[local] = component_source[order[local - 1]];
+                    ordered_sink[local] = component_sink[order[local - 1]];
+                }
+                component_source.swap(ordered_source);
+                component_sink.swap(ordered_sink);
+            }
+            component.compact();
+            // with a single batch, its threads set its network up instead
+            solver.buildNetwork(component, size, component_source.data(), component_sink.data(),
+                                lambda_values.data(), n_lits, out_of_core, workers <= 1 ? threads : 1);
+            solver.setFullSweep(full_sweep);
+            solver.solve();
+            swept += solver.solvedParams();
+            for (int local = 1; local <= size; local++) {
+                solved[global_node[local - 1] - 1] = solver.breakpoint(local);
+            }
+            solver.reset();
+        };
+        if (workers <= 1) {
+            PseudoflowSolver solver;
+            for (size_t batch = 0; batch < batches; batch++) {
+                solveBatch(batch, solver);
+            }
+        } else {
+            std::atomic<size_t> next_batch(0);
+            std::vector<std::exception_ptr> errors(workers);
+            std::vector<std::thread> pool;
+            for (size_t worker = 0; worker < workers; worker++) {
+                pool.emplace_back([&, worker]() {
+                    try {
+                        PseudoflowSolver solver;
+                        for (size_t batch = next_batch++; batch < batches; batch = next_batch++) {
+                            solveBatch(batch, solver);
+                        }
+                    } catch (...) {
+                        errors[worker] = std::current_exception();
+                    }
+                });
+            }
+            for (std::thread& thread: pool) {
+                thread.join();
+            }
+            for (std::exception_ptr& error: errors) {
+                if (error) std::rethrow_exception(error);
+            }
+        }
+        out_of_core_network_nodes += out_of_core_nodes;
+        solved_networks += batches;
+        swept_params += swept;
+        return batch_nodes.size();
+    }
+
+    void Graph::collectClusters() {
+        int literal_nodes = literalNodes();
+        clusters.clear();
+        community_nodes.clear();
+        for (int l = 0; l < (int)breakpoints.size(); l++) {
+            int cluster = breakpoints[l];
+            if (l == literal_nodes) std::cout << clusters.size() << ",";
             if(clusters.find(cluster) == clusters.end()) {
                 clusters[cluster] = std::vector<int>();
             }
             clusters[cluster].push_back(l + 1);
         }
-        for (int l = 0; l < numNodes; l++) {
-        community_nodes.push_back(adjacencyList[l].breakpoint);
+        for (int l = 0; l < (int)breakpoints.size(); l++) {
+        community_nodes.push_back(breakpoints[l]);
         }
     }
 
     std::pair<double, double> Graph::calculateVariance() {
         std::unordered_map<int, int> communityCountA;
         std::unordered_map<int, int> communityCountB;
-        int n = n_lits / 2;
+        int literal_nodes = literalNodes();
         // Count the frequency of nodes in each community for type A and type B
-        for (int i = 0; i < 2 * n; ++i) {
+        for (int i = 0; i < literal_nodes; ++i) {
             communityCountB[community_nodes[i]]++;
         }
-        for (unsigned long i = 2 * n; i < community_nodes.size(); ++i) {
+        for (unsigned long i = literal_nodes; i < community_nodes.size(); ++i) {
             communityCountA[community_nodes[i]]++;
         }
 
@@ -148,21 +615,22 @@ namespace mrfsat {
     std::pair<double, double> Graph::calculateWeightedVariance() {
         std::unordered_map<int, double> communityStrengthA;
         std::unordered_map<int, double> communityStrengthB;
-        int n = n_lits / 2;
+        int literal_nodes = literalNodes();
 
         // Calculate the strength of nodes of type A and B in each community
-        for (const auto& [node, neighbors] : adjacency_list) {
+        for (int node = 0; node < csr_graph.rows(); node++) {
+            if (csr_graph.begin(node) == csr_graph.end(node)) continue;
             int community = community_nodes[node];
-            for (const auto& [neighbor, weight] : neighbors) {
-                if (node < 2 * n && neighbor < 2 * n) {  // Both nodes are of type B
+            csr_graph.forEachEdge(node, [&](int neighbor, float weight) {
+                if (node < literal_nodes && neighbor < literal_nodes) {  // Both nodes are of type B
                     communityStrengthB[community] += weight;
-                } else if (node >= 2 * n && neighbor >= 2 * n) {  // Both nodes are of type A
+                } else if (node >= literal_nodes && neighbor >= literal_nodes) {  // Both nodes are of type A
                     communityStrengthA[community] += weight;
                 } else {  // One node is of type A, the other of type B
                     communityStrengthA[community] += weight / 2;
                     communityStrengthB[community] += weight / 2;
                 }
-            }
+            });
         }
 
         // Calculate weighted ratios
@@ -186,6 +654,10 @@ namespace mrfsat {
 
     void Graph::calculateGraphData() {
         calculateMRFClusters();
+        reportGraphData();
+    }
+
+    void Graph::reportGraphData() {
         std::cout << clusters.size() << "," << n_constraints << "," << n_lits / 2 << ",";
         std::pair<double, double> variance_diff = calculateVariance();
         std::cout << variance_diff.first << "," << variance_diff.second;
@@ -193,7 +665,11 @@ namespace mrfsat {
     }
 
     void Graph::NormalizeEqualConstraint(int constraint_id) {
+        if (constraint_id < 0) throw std::runtime_error("Negative constraint id");
         to_normalize_amount++;
-        normalization_marks[constraint_id] = 1;        
+        if ((size_t)constraint_id >= normalization_marks.size()) {
+            normalization_marks.resize((size_t)constraint_id + 1, 0);
+        }
+        normalization_marks[constraint_id] = 1;
     }
 }
\ No newline at end of file
@@ -19,50 +19,163 @@
 
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <numeric>
 #include <cmath>
+#include <string>
+#include <stdexcept>
+#include "csrgraph.hpp"
+#include "preprocess.hpp"
+#include "ordering.hpp"
 
 namespace mrfsat {
 
-using NodeMap = std::unordered_map<int, long double>;
+/*
+    How variables become nodes: Literal gives x and -x a node each, Variable
+    gives every variable a single node joined to the constraints of both
+    its literals, which roughly halves the literal side of the network.
+    Edges carry no polarity, so where x and -x share a constraint their
+    weights are added up into one edge. Either way every declared variable
+    keeps its nodes, used or not, so node ids match across encodings and
+    constraints added later can use any variable.
+*/
+enum class Encoding { Literal, Variable };
+
+// literal and coefficient of one term of a constraint
+using ConstraintTerms = std::vector<std::pair<int, int> >;
+// edges from one node to another with their weight
+using EdgeList = std::vector<std::pair<std::pair<int, int>, float> >;
 class Graph {
     public:
         Graph() {
             n_lits = 0;
             to_normalize_amount = 0;
+            built = false;
+            encoding = Encoding::Literal;
+            threads = 1;
         }
+        void setThreads(int n_threads) {threads = n_threads;}
+        // keep the constraint terms once built so that they can be removed
+        void setIncremental(bool keep) {keep_constraints = keep;}
+        void setOrdering(NodeOrdering new_ordering) {ordering = new_ordering;}
+        // solve a graph coarsened this many times and refine the result
+        void setCoarsening(int levels) {coarsen_levels = levels;}
+        // bytes the graph and its flow networks may take before they are
+        // kept out of core, 0 for no limit
+        void setMemoryBudget(int64_t bytes) {memory_budget = bytes;}
+        // solve each flow network at every parameter, see PseudoflowSolver::setFullSweep
+        void setFullSweep(bool full) {full_sweep = full;}
+        void setEncoding(Encoding new_encoding) {encoding = new_encoding;}
+        Encoding getEncoding() const {return encoding;}
+        void reserve(int declared_variables, int declared_constraints);
         void addVariableToConstraint(int constraint_id, std::pair <int, int> variable_data);
         void addConstraintCoefficient(int constraint_id, int constraint_coefficient);
         void showGraph() {
-            for(auto& [node, adj_node]: adjacency_list) {
+            if (!built) {
+                for (int node = 0; node < (int)constraint_terms.size(); node++) {
+                    if (constraint_terms[node].empty()) continue;
+                    std::cout << "Constraint #" << node << std::endl;
+                    std::cout << constraintCoefficient(node) << std::endl;
+                    std::cout << "-------" << std::endl;
+                    for (auto& [var_node, coeff]: constraint_terms[node]) {
+                        std::cout << var_node << " " << coeff << std::endl;
+                    }
+                }
+                return;
+            }
+            for (int node = 0; node < csr_graph.rows(); node++) {
+                if (csr_graph.begin(node) == csr_graph.end(node)) continue;
                 std::cout << "Constraint #" << node << std::endl;
-                std::cout << constraint_coefficients[node] << std::endl;
+                std::cout << constraintCoefficient(node) << std::endl;
                 std::cout << "-------" << std::endl;
-                for (auto& [var_node, coeff]: adj_node) {
-                    std::cout << var_node << " " << coeff << std::endl;
-                }
+                csr_graph.forEachEdge(node, [](int neighbor, float weight) {
+                    std::cout << neighbor << " " << weight << std::endl;
+                });
             }
         }
+        PreprocessStats preprocess();
         void buildFromConstraints();
+        int64_t sparsify(float epsilon);
+        void saveSnapshot(const std::string& file_name);
+        void loadSnapshot(const char* begin, const char* end);
         void updateLiteralsAmount(int new_number);
         void setConstraintsNumber(int new_n_constraints) {n_constraints = new_n_constraints;}
         void calculateGraphData();
-        void updateAdjacencyList(std::unordered_map<int, NodeMap>& new_adjacency_list, int graph_node, int constraint_node, int value, int divisor, bool isNormalized);
+        int addConstraint(ConstraintTerms terms, int constraint_coefficient, bool is_equality);
+        int addConstraints(const Graph& parsed);
+        void removeConstraint(int constraint_id);
+        void updateGraphData(bool warm = true);
+        int64_t solvedNodes() const {return solved_nodes;}
+        int coarseNodes() const {return coarse_nodes;}
+        int64_t refinedNodes() const {return refined_nodes;}
+        bool edgesOutOfCore() const {return csr_graph.outOfCore();}
+        int64_t outOfCoreNodes() const {return out_of_core_network_nodes;}
+        // flow networks solved and parameters swept over all of them
+        int64_t solvedNetworks() const {return solved_networks;}
+        int64_t sweptParams() const {return swept_params;}
+        int parametersAmount() const {return n_lits;}
         int getGraphNode(int lit_node);
         void NormalizeEqualConstraint(int constraint_id);
         std::vector<int> community_nodes;
         std::unordered_map<int, std::vector<int> > clusters;
     private:
+        // fewest nodes the flow network of a batch of components is given
+        static const int MIN_BATCH_NODES = 256;
+        static void mergeTerms(ConstraintTerms& terms);
+        void mergeRepeatedLiterals();
+        std::vector<int> constraintOrder();
+        int literalNodes() const;
+        int constraintCoefficient(int constraint_id) const;
+        bool isEqualized(int constraint_id) const;
+        template <typename Visit> void visitConstraint(int constraint_node, const ConstraintTerms& lit_nodes,
+                                                       bool equalized, int equality_offset, Visit visit);
+        template <typename Visit> void visitEdges(Visit visit, bool release);
+        void constraintEdges(int constraint_id, EdgeList& edges);
+        void changeEdges(EdgeList& changes, bool remove);
         void calculateMRFClusters();
+        void solveBreakpoints(bool warm);
+        void solveCoarsened(int nodes_amount, const std::vector<float>& lambda_values);
+        int64_t solveNetwork(const CSRGraph& graph, int nodes_amount, const std::vector<float>& source_values,
+                             const std::vector<float>& sink_values, const std::vector<float>& lambda_values,
+                             const std::vector<char>& dirty, bool whole_components, std::vector<int>& solved);
+        void collectClusters();
+        void reportGraphData();
         std::pair<double, double> calculateVariance();
         std::pair<double, double> calculateWeightedVariance();
-        std::unordered_map<int, NodeMap> adjacency_list;
-        std::unordered_map<int, int> constraint_coefficients;
-        std::unordered_map<int, int> normalization_marks;
+        // terms of each constraint by id until the graph is built, or for
+        // good in an incremental graph, along with the offset of the second
+        // node of each equality
+        std::vector<ConstraintTerms> constraint_terms;
+        std::vector<int> equality_offsets;
+        bool keep_constraints = false;
+        CSRGraph csr_graph;
+        std::vector<int> constraint_coefficients;
+        std::vector<char> normalization_marks;
         int to_normalize_amount = 0;
         int n_lits;
         int n_constraints;
+        bool built;
+        Encoding encoding;
+        int threads;
+        NodeOrdering ordering = NodeOrdering::Identity;
+        float sparsify_epsilon = -1;
+        int coarsen_levels = 0;
+        int coarse_nodes = 0;
+        int64_t refined_nodes = 0;
+        int64_t memory_budget = 0;
+        int64_t out_of_core_network_nodes = 0;
+        bool full_sweep = false;
+        int64_t solved_networks = 0;
+        int64_t swept_params = 0;
+        // what the last solve saw, so an update only solves what changed
+        int normalization_size = 0;
+        std::vector<int> breakpoints;
+        std::vector<float> solved_source;
+        std::vector<float> solved_sink;
+        std::vector<char> dirty_nodes;
+        int64_t solved_nodes = 0;
 };
 }
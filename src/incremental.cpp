@@ -0,0 +1,150 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "graph.hpp"
+#include <stdexcept>
+
+
+namespace mrfsat {
+/*
+    Constraints can be added to a built graph and, when it was built with
+    setIncremental, taken out again; updateGraphData then re-clusters it.
+    Node ids never move: an added constraint gets the nodes after the last
+    one and a removed one leaves its nodes without edges. The update keeps
+    the normalization of the last full solve, so its figures stay on the
+    scale the instance was first measured at, and only components with a
+    changed edge or arc capacity are solved again. A cold update solves
+    every component again on that same scale, which the warm one must match.
+*/
+
+void Graph::changeEdges(EdgeList& changes, bool remove) {
+    // the last change of a pair of nodes is the one that counts, as in
+    // the build; an edge the sparsification would drop is a removal
+    std::stable_sort(changes.begin(), changes.end(),
+        [](const EdgeList::value_type& a, const EdgeList::value_type& b) { return a.first < b.first; });
+    int rows = csr_graph.rows();
+    for (const auto& change: changes) {
+        rows = std::max(rows, std::max(change.first.first, change.first.second) + 1);
+    }
+    if ((int)dirty_nodes.size() < rows) dirty_nodes.resize(rows, 1);
+    csr_graph.expand();
+
+    CSRGraph changed;
+    changed.setOutOfCore(csr_graph.outOfCore());
+    changed.offsets.assign(rows + 1, 0);
+    changed.neighbors.reserve(csr_graph.edges() + (remove ? 0 : changes.size()));
+    changed.weights.reserve(csr_graph.edges() + (remove ? 0 : changes.size()));
+    size_t next = 0;
+    for (int node = 0; node < rows; node++) {
+        int64_t edge = csr_graph.begin(node);
+        int64_t row_end = csr_graph.end(node);
+        while (next < changes.size() && changes[next].first.first == node) {
+            if (next + 1 < changes.size() && changes[next + 1].first == changes[next].first) {
+                next++;
+                continue;
+            }
+            int neighbor = changes[next].first.second;
+            float weight = changes[next].second;
+            for (; edge < row_end && csr_graph.neighbors[edge] < neighbor; edge++) {
+                changed.neighbors.push_back(csr_graph.neighbors[edge]);
+                changed.weights.push_back(csr_graph.weights[edge]);
+            }
+            bool present = edge < row_end && csr_graph.neighbors[edge] == neighbor;
+            bool keep = !remove && !(sparsify_epsilon >= 0 && weight <= sparsify_epsilon);
+            if (keep) {
+                changed.neighbors.push_back(neighbor);
+                changed.weights.push_back(weight);
+            }
+            if (present != keep || (present && csr_graph.weights[edge] != weight)) {
+                dirty_nodes[node] = 1;
+                dirty_nodes[neighbor] = 1;
+            }
+            if (present) edge++;
+            next++;
+        }
+        for (; edge < row_end; edge++) {
+            changed.neighbors.push_back(csr_graph.neighbors[edge]);
+            changed.weights.push_back(csr_graph.weights[edge]);
+        }
+        changed.offsets[node + 1] = changed.neighbors.size();
+    }
+    changed.compact();
+    csr_graph = std::move(changed);
+}
+
+int Graph::addConstraint(ConstraintTerms terms, int constraint_coefficient, bool is_equality) {
+    if (!built) {
+        throw std::runtime_error("Constraints can only be added to a built graph");
+    }
+    for (const auto& [literal, coefficient]: terms) {
+        if (literal == 0 || std::abs(literal) > n_lits / 2) {
+            throw std::runtime_error("Added constraint uses variable " + std::to_string(std::abs(literal)) +
+                                     " outside the instance");
+        }
+    }
+    mergeTerms(terms);
+    int constraint_id = n_constraints + 1;
+    size_t size = constraint_id + 1;
+    if (constraint_terms.size() < size) constraint_terms.resize(size);
+    if (constraint_coefficients.size() < size) constraint_coefficients.resize(size, 0);
+    if (normalization_marks.size() < size) normalization_marks.resize(size, 0);
+    if (equality_offsets.size() < size) equality_offsets.resize(size, 0);
+    constraint_terms[constraint_id] = std::move(terms);
+    constraint_coefficients[constraint_id] = constraint_coefficient;
+    normalization_marks[constraint_id] = is_equality;
+    equality_offsets[constraint_id] = is_equality ? 1 : 0;
+
+    EdgeList edges;
+    constraintEdges(constraint_id, edges);
+    changeEdges(edges, false);
+    n_constraints += is_equality ? 2 : 1;
+    return constraint_id;
+}
+
+int Graph::addConstraints(const Graph& parsed) {
+    int added = 0;
+    for (int constraint_id = 0; constraint_id < (int)parsed.constraint_terms.size(); constraint_id++) {
+        if (parsed.constraint_terms[constraint_id].empty()) continue;
+        addConstraint(parsed.constraint_terms[constraint_id], parsed.constraintCoefficient(constraint_id),
+                      parsed.isEqualized(constraint_id));
+        added++;
+    }
+    return added;
+}
+
+void Graph::removeConstraint(int constraint_id) {
+    if (constraint_id < 0 || constraint_id >= (int)constraint_terms.size() || constraint_terms[constraint_id].empty()) {
+        throw std::runtime_error("No constraint " + std::to_string(constraint_id) +
+                                 " to remove, graphs keep them only when built incrementally");
+    }
+    EdgeList edges;
+    constraintEdges(constraint_id, edges);
+    changeEdges(edges, true);
+    ConstraintTerms().swap(constraint_terms[constraint_id]);
+    if (constraint_id < (int)normalization_marks.size()) normalization_marks[constraint_id] = 0;
+}
+
+void Graph::updateGraphData(bool warm) {
+    if (breakpoints.empty()) {
+        calculateGraphData();
+        return;
+    }
+    solveBreakpoints(warm);
+    collectClusters();
+    reportGraphData();
+}
+}
@@ -0,0 +1,305 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "inputstream.hpp"
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef MRFSAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MRFSAT_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef MRFSAT_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+
+namespace mrfsat {
+
+static const size_t INPUT_BUFFER_SIZE = 1 << 20;
+
+struct InputStream::Decoder {
+    /*
+        One decompression stream for the detected format. Concatenated
+        gzip and bzip2 members are decoded one after the other, as gzip
+        and bzip2 do on the command line.
+    */
+    Compression format;
+    bool finished = false;
+#ifdef MRFSAT_HAVE_ZLIB
+    z_stream gzip;
+#endif
+#ifdef MRFSAT_HAVE_BZIP2
+    bz_stream bzip2;
+#endif
+#ifdef MRFSAT_HAVE_LZMA
+    lzma_stream xz = LZMA_STREAM_INIT;
+#endif
+
+    explicit Decoder(Compression compression) : format(compression) {
+        switch (format) {
+            case Compression::Gzip:
+#ifdef MRFSAT_HAVE_ZLIB
+                std::memset(&gzip, 0, sizeof(gzip));
+                // 32 lets zlib accept the gzip header
+                if (inflateInit2(&gzip, 15 + 32) != Z_OK) throw std::runtime_error("Could not initialize gzip decoder");
+                return;
+#else
+                throw std::runtime_error("gzip input is not supported by this build");
+#endif
+            case Compression::Bzip2:
+#ifdef MRFSAT_HAVE_BZIP2
+                std::memset(&bzip2, 0, sizeof(bzip2));
+                if (BZ2_bzDecompressInit(&bzip2, 0, 0) != BZ_OK) throw std::runtime_error("Could not initialize bzip2 decoder");
+                return;
+#else
+                throw std::runtime_error("bzip2 input is not supported by this build");
+#endif
+            case Compression::Xz:
+#ifdef MRFSAT_HAVE_LZMA
+                if (lzma_stream_decoder(&xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) throw std::runtime_error("Could not initialize xz decoder");
+                return;
+#else
+                throw std::runtime_error("xz input is not supported by this build");
+#endif
+            case Compression::None:
+                return;
+        }
+    }
+
+    ~Decoder() {
+        switch (format) {
+#ifdef MRFSAT_HAVE_ZLIB
+            case Compression::Gzip: inflateEnd(&gzip); break;
+#endif
+#ifdef MRFSAT_HAVE_BZIP2
+            case Compression::Bzip2: BZ2_bzDecompressEnd(&bzip2); break;
+#endif
+#ifdef MRFSAT_HAVE_LZMA
+            case Compression::Xz: lzma_end(&xz); break;
+#endif
+            default: break;
+        }
+    }
+
+    void nextMember() {
+        switch (format) {
+#ifdef MRFSAT_HAVE_ZLIB
+            case Compression::Gzip: inflateReset(&gzip); break;
+#endif
+#ifdef MRFSAT_HAVE_BZIP2
+            case Compression::Bzip2:
+                BZ2_bzDecompressEnd(&bzip2);
+                std::memset(&bzip2, 0, sizeof(bzip2));
+                BZ2_bzDecompressInit(&bzip2, 0, 0);
+                break;
+#endif
+            default: break;
+        }
+    }
+
+    // decodes from [in, in + in_size) into [out, out + out_size), advancing
+    // both; returns true at the end of a compressed member
+    bool step(const char*& in, size_t& in_size, char*& out, size_t& out_size, bool at_end) {
+        switch (format) {
+#ifdef MRFSAT_HAVE_ZLIB
+            case Compression::Gzip: {
+                gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+                gzip.avail_in = in_size;
+                gzip.next_out = reinterpret_cast<Bytef*>(out);
+                gzip.avail_out = out_size;
+                int status = inflate(&gzip, Z_NO_FLUSH);
+                in += in_size - gzip.avail_in;
+                out += out_size - gzip.avail_out;
+                in_size = gzip.avail_in;
+                out_size = gzip.avail_out;
+                if (status == Z_STREAM_END) return true;
+                if (status != Z_OK && status != Z_BUF_ERROR) throw std::runtime_error("Corrupted gzip input");
+                return false;
+            }
+#endif
+#ifdef MRFSAT_HAVE_BZIP2
+            case Compression::Bzip2: {
+                bzip2.next_in = const_cast<char*>(in);
+                bzip2.avail_in = in_size;
+                bzip2.next_out = out;
+                bzip2.avail_out = out_size;
+                int status = BZ2_bzDecompress(&bzip2);
+                in += in_size - bzip2.avail_in;
+                out += out_size - bzip2.avail_out;
+                in_size = bzip2.avail_in;
+                out_size = bzip2.avail_out;
+                if (status == BZ_STREAM_END) return true;
+                if (status != BZ_OK) throw std::runtime_error("Corrupted bzip2 input");
+                return false;
+            }
+#endif
+#ifdef MRFSAT_HAVE_LZMA
+            case Compression::Xz: {
+                xz.next_in = reinterpret_cast<const uint8_t*>(in);
+                xz.avail_in = in_size;
+                xz.next_out = reinterpret_cast<uint8_t*>(out);
+                xz.avail_out = out_size;
+                lzma_ret status = lzma_code(&xz, at_end ? LZMA_FINISH : LZMA_RUN);
+                in += in_size - xz.avail_in;
+                out += out_size - xz.avail_out;
+                in_size = xz.avail_in;
+                out_size = xz.avail_out;
+                if (status == LZMA_STREAM_END) return true;
+                if (status != LZMA_OK && status != LZMA_BUF_ERROR) throw std::runtime_error("Corrupted xz input");
+                return false;
+            }
+#endif
+            default:
+                (void) at_end;
+                return true;
+        }
+    }
+};
+
+InputStream::InputStream() : fd(-1), compression_(Compression::None), input_begin(0), input_end(0), input_done(false), peeked_begin(0) {}
+
+InputStream::~InputStream() {
+    decoder.reset();
+    if (fd > 0) {
+        close(fd);
+    }
+}
+
+bool InputStream::open(const std::string& file_name) {
+    if (file_name == "-") {
+        fd = 0;
+    } else if ((fd = ::open(file_name.c_str(), O_RDONLY)) < 0) {
+        return false;
+    }
+    input.resize(INPUT_BUFFER_SIZE);
+    // stdin cannot be rewound, so the magic bytes stay in the input buffer
+    while (input_end < 6 && !input_done) {
+        ssize_t n = ::read(fd, input.data() + input_end, input.size() - input_end);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            input_done = true;
+        } else {
+            input_end += n;
+        }
+    }
+    compression_ = detectCompression(input.data(), input_end);
+    if (compression_ != Compression::None) {
+        decoder = std::make_unique<Decoder>(compression_);
+    }
+    return true;
+}
+
+InputStream::Compression InputStream::detectCompression(const char* data, size_t size) {
+    const unsigned char* magic = reinterpret_cast<const unsigned char*>(data);
+    if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return Compression::Gzip;
+    } else if (size >= 3 && std::memcmp(magic, "BZh", 3) == 0) {
+        return Compression::Bzip2;
+    } else if (size >= 6 && std::memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return Compression::Xz;
+    }
+    return Compression::None;
+}
+
+bool InputStream::fillInput() {
+    input_begin = 0;
+    input_end = 0;
+    while (!input_done) {
+        ssize_t n = ::read(fd, input.data(), input.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+        if (n == 0) {
+            input_done = true;
+        } else {
+            input_end = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t InputStream::readRaw(char* buffer, size_t capacity) {
+    if (input_begin < input_end) {
+        size_t n = std::min(capacity, input_end - input_begin);
+        std::memcpy(buffer, input.data() + input_begin, n);
+        input_begin += n;
+        return n;
+    }
+    while (!input_done) {
+        ssize_t n = ::read(fd, buffer, capacity);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+        if (n == 0) input_done = true;
+        return n;
+    }
+    return 0;
+}
+
+std::string InputStream::peek(size_t size) {
+    while (peeked.size() - peeked_begin < size) {
+        size_t old_size = peeked.size();
+        peeked.resize(peeked_begin + size);
+        size_t n = readDecoded(&peeked[old_size], peeked.size() - old_size);
+        peeked.resize(old_size + n);
+        if (n == 0) break;
+    }
+    return peeked.substr(peeked_begin);
+}
+
+size_t InputStream::read(char* buffer, size_t capacity) {
+    if (peeked_begin < peeked.size()) {
+        size_t n = std::min(capacity, peeked.size() - peeked_begin);
+        std::memcpy(buffer, peeked.data() + peeked_begin, n);
+        peeked_begin += n;
+        return n;
+    }
+    return readDecoded(buffer, capacity);
+}
+
+size_t InputStream::readDecoded(char* buffer, size_t capacity) {
+    if (compression_ == Compression::None) {
+        return readRaw(buffer, capacity);
+    }
+    char* out = buffer;
+    size_t out_size = capacity;
+    while (out_size > 0 && !decoder->finished) {
+        if (input_begin == input_end) fillInput();
+        const char* in = input.data() + input_begin;
+        size_t in_size = input_end - input_begin;
+        bool at_end = in_size == 0 && input_done;
+        size_t before = out_size;
+        bool member_end = decoder->step(in, in_size, out, out_size, at_end);
+        input_begin = input_end - in_size;
+        if (member_end) {
+            if (input_begin == input_end) fillInput();
+            if (input_begin == input_end) {
+                decoder->finished = true;
+            } else {
+                decoder->nextMember();
+            }
+        } else if (at_end && out_size == before) {
+            throw std::runtime_error("Unexpected end of compressed input");
+        }
+    }
+    return capacity - out_size;
+}
+}
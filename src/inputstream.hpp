@@ -0,0 +1,61 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace mrfsat {
+class InputStream {
+    /*
+        Sequential reader over a file or stdin ("-") that transparently
+        decompresses gzip, bzip2 and xz input. The format is detected
+        from the magic bytes at the start of the data, not from the
+        file extension. Decompression errors throw std::runtime_error.
+    */
+    public:
+        enum class Compression { None, Gzip, Bzip2, Xz };
+        InputStream();
+        ~InputStream();
+        InputStream(const InputStream&) = delete;
+        InputStream& operator=(const InputStream&) = delete;
+        bool open(const std::string& file_name);
+        // fills up to capacity bytes of decompressed data, 0 at the end
+        size_t read(char* buffer, size_t capacity);
+        // next decompressed bytes, which are still returned by read
+        std::string peek(size_t size);
+        Compression compression() const { return compression_; }
+        static Compression detectCompression(const char* data, size_t size);
+        bool isStdin() const { return fd == 0; }
+    private:
+        struct Decoder;
+        bool fillInput();
+        size_t readRaw(char* buffer, size_t capacity);
+        size_t readDecoded(char* buffer, size_t capacity);
+        int fd;
+        Compression compression_;
+        std::vector<char> input;
+        size_t input_begin;
+        size_t input_end;
+        bool input_done;
+        std::string peeked;
+        size_t peeked_begin;
+        std::unique_ptr<Decoder> decoder;
+};
+}
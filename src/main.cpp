@@ -16,18 +16,270 @@
 */
 
 #include "filereader.hpp"
+#include "prefetcher.hpp"
+#include "estimate.hpp"
 #include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
 
 
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
-        return 1;
+struct Options {
+    int threads = 1;
+    int prefetch_depth = 4;
+    size_t prefetch_memory = 1024;
+    float sparsify_epsilon = 0;
+    int coarsen_levels = 0;
+    bool full_sweep = false;
+    size_t memory_budget = 0;
+    bool preprocess = false;
+    bool estimate = false;
+    mrfsat::Encoding encoding = mrfsat::Encoding::Literal;
+    mrfsat::NodeOrdering ordering = mrfsat::NodeOrdering::Identity;
+    std::string snapshot_name;
+    std::string added_constraints;
+    std::vector<std::string> inputs;
+};
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <filename>..." << std::endl;
+    std::cerr << "  <filename> is an OPB or DIMACS CNF instance, possibly gzip, bzip2 or xz" << std::endl;
+    std::cerr << "  compressed, a graph snapshot, or a directory of instances; - reads stdin" << std::endl;
+    std::cerr << "  --threads N             parse and solve with N threads, 0 uses every core (default 1)" << std::endl;
+    std::cerr << "  --save-snapshot FILE    write the built graph to FILE, which can be given" << std::endl;
+    std::cerr << "                          as <filename> later to skip parsing" << std::endl;
+    std::cerr << "  --encoding literal|variable" << std::endl;
+    std::cerr << "                          one node per literal, or one node per variable (default literal)," << std::endl;
+    std::cerr << "                          a snapshot keeps the encoding it was built with; the variable" << std::endl;
+    std::cerr << "                          encoding adds x and -x of a constraint up into one edge, so" << std::endl;
+    std::cerr << "                          polarity is lost, and keeps a node for every declared variable" << std::endl;
+    std::cerr << "  --preprocess            remove duplicate and satisfied constraints, fixed variables" << std::endl;
+    std::cerr << "                          and pure literals before the graph is built" << std::endl;
+    std::cerr << "  --ordering none|bfs|rcm|degree" << std::endl;
+    std::cerr << "                          number the nodes of each flow network by id, breadth first," << std::endl;
+    std::cerr << "                          reverse Cuthill-McKee or degree; results do not change (default none)" << std::endl;
+    std::cerr << "  --coarsen-levels N      solve a graph coarsened N times by matching neighbors, then" << std::endl;
+    std::cerr << "                          solve again the nodes it can not settle (default 0)" << std::endl;
+    std::cerr << "  --sweep full|adaptive   solve each flow network at every parameter, or only where its" << std::endl;
+    std::cerr << "                          capacities change; results do not change (default adaptive)" << std::endl;
+    std::cerr << "  --memory-budget MB      keep the edges and flow networks in scratch files under" << std::endl;
+    std::cerr << "                          $TMPDIR once they would take more, 0 for no limit (default 0)" << std::endl;
+    std::cerr << "  --estimate              only count each instance and print, as one JSON object per" << std::endl;
+    std::cerr << "                          line, the memory it is expected to take at most" << std::endl;
+    std::cerr << "  --sparsify-epsilon E    drop edges of weight at most E before the flow solve," << std::endl;
+    std::cerr << "                          a negative E keeps every edge (default 0)" << std::endl;
+    std::cerr << "  --add-constraints FILE  after each instance, add the constraints of FILE and print" << std::endl;
+    std::cerr << "                          a second line re-clustered from the first solve" << std::endl;
+    std::cerr << "  --prefetch N            read up to N instances ahead of the current one (default 4)" << std::endl;
+    std::cerr << "  --prefetch-memory MB    buffer memory for instances read ahead (default 1024)" << std::endl;
+}
+
+static bool parseOrdering(const std::string& name, mrfsat::NodeOrdering& ordering) {
+    if (name == "none") ordering = mrfsat::NodeOrdering::Identity;
+    else if (name == "bfs") ordering = mrfsat::NodeOrdering::BFS;
+    else if (name == "rcm") ordering = mrfsat::NodeOrdering::ReverseCuthillMcKee;
+    else if (name == "degree") ordering = mrfsat::NodeOrdering::Degree;
+    else return false;
+    return true;
+}
+
+// The whole of text must be the number, in range; anything else is a usage error.
+static bool parseInt(const std::string& text, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = parsed;
+    return true;
+}
+
+static bool parseSize(const std::string& text, size_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) return false;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > SIZE_MAX >> 20) return false;
+    value = parsed;
+    return true;
+}
+
+static bool parseFloat(const std::string& text, float& value) {
+    char* end = nullptr;
+    errno = 0;
+    float parsed = std::strtof(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || errno == ERANGE) return false;
+    value = parsed;
+    return true;
+}
+
+static std::vector<std::string> expandInputs(const std::vector<std::string>& inputs) {
+    // directories stand for the regular files in them, in name order
+    std::vector<std::string> files;
+    for (const std::string& input: inputs) {
+        if (input != "-" && std::filesystem::is_directory(input)) {
+            std::vector<std::string> entries;
+            for (const auto& entry: std::filesystem::directory_iterator(input)) {
+                if (entry.is_regular_file()) entries.push_back(entry.path().string());
+            }
+            std::sort(entries.begin(), entries.end());
+            files.insert(files.end(), entries.begin(), entries.end());
+        } else {
+            files.push_back(input);
+        }
     }
+    return files;
+}
+
+static void estimateInstance(const std::string& file_name, const Options& options) {
+    mrfsat::InstanceCounts counts = mrfsat::countInstance(file_name);
+    int64_t budget = options.memory_budget << 20;
+    mrfsat::FootprintEstimate estimate = mrfsat::estimateFootprint(counts, options.encoding, options.threads, budget);
+    mrfsat::writeEstimateJson(std::cout, file_name, counts, estimate, options.encoding, budget);
+}
+
+static bool analyseInstance(mrfsat::PrefetchedFile& file, const Options& options) {
     mrfsat::FileReader reader;
-    reader.parseFile(argv[1]);
-    std::cout << std::filesystem::path(argv[1]).filename() << ",";
+    reader.setThreads(options.threads);
+    reader.graph.setEncoding(options.encoding);
+    reader.graph.setOrdering(options.ordering);
+    reader.graph.setCoarsening(options.coarsen_levels);
+    reader.graph.setMemoryBudget(options.memory_budget << 20);
+    reader.graph.setFullSweep(options.full_sweep);
+    // keep the terms of the instance, so constraints can be taken out again
+    reader.graph.setIncremental(!options.added_constraints.empty());
+    if (!file.loaded || !reader.parseContents(file.contents.get(), file.contents.get() + file.size)) {
+        if (!reader.parseFile(file.file_name)) return false;
+    }
+    file.contents.reset();
+    mrfsat::PreprocessStats stats;
+    if (options.preprocess) stats = reader.graph.preprocess();
+    std::cout << std::filesystem::path(file.file_name).filename() << ",";
     reader.graph.buildFromConstraints();
+    if (!options.snapshot_name.empty()) {
+        reader.graph.saveSnapshot(options.snapshot_name);
+    }
+    int64_t removed = reader.graph.sparsify(options.sparsify_epsilon);
     reader.graph.calculateGraphData();
-    return 0;
+    if (!options.added_constraints.empty()) {
+        mrfsat::FileReader added;
+        if (!added.parseFile(options.added_constraints)) return false;
+        int constraints = reader.graph.addConstraints(added.graph);
+        std::filesystem::path name = std::filesystem::path(file.file_name).filename().string() + "+" +
+                                     std::filesystem::path(options.added_constraints).filename().string();
+        std::cout << name << ",";
+        reader.graph.updateGraphData();
+        std::cerr << file.file_name << ": added " << constraints << " constraints and solved "
+                  << reader.graph.solvedNodes() << " nodes again" << std::endl;
+    }
+    if (stats.conflict) {
+        std::cerr << file.file_name << ": preprocessing found a conflict, the instance was left as it is" << std::endl;
+    } else if (options.preprocess) {
+        std::cerr << file.file_name << ": preprocessing kept " << stats.constraints_after << " of "
+                  << stats.constraints_before << " constraints and " << stats.terms_after << " of "
+                  << stats.terms_before << " terms (" << stats.duplicate_constraints << " duplicate, "
+                  << stats.satisfied_constraints << " satisfied, " << stats.fixed_variables << " fixed variables, "
+                  << stats.pure_literals << " pure literals)" << std::endl;
+    }
+    if (options.coarsen_levels > 0) {
+        std::cerr << file.file_name << ": solved " << reader.graph.coarseNodes() << " coarse nodes and "
+                  << reader.graph.refinedNodes() << " nodes again" << std::endl;
+    }
+    if (!options.full_sweep) {
+        std::cerr << file.file_name << ": swept " << reader.graph.sweptParams() << " of "
+                  << reader.graph.solvedNetworks() * reader.graph.parametersAmount() << " parameters over "
+                  << reader.graph.solvedNetworks() << " flow networks" << std::endl;
+    }
+    if (reader.graph.edgesOutOfCore() || reader.graph.outOfCoreNodes() > 0) {
+        std::cerr << file.file_name << ": kept " << (reader.graph.edgesOutOfCore() ? "the edges and " : "")
+                  << reader.graph.outOfCoreNodes() << " network nodes out of core" << std::endl;
+    }
+    if (removed > 0) {
+        std::cerr << file.file_name << ": removed " << removed << " edges of weight at most "
+                  << options.sparsify_epsilon << std::endl;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc && parseInt(argv[i + 1], options.threads)) {
+            i++;
+            if (options.threads <= 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg == "--save-snapshot" && i + 1 < argc) {
+            options.snapshot_name = argv[++i];
+        } else if (arg == "--encoding" && i + 1 < argc && std::string(argv[i + 1]) == "literal") {
+            options.encoding = mrfsat::Encoding::Literal;
+            i++;
+        } else if (arg == "--encoding" && i + 1 < argc && std::string(argv[i + 1]) == "variable") {
+            options.encoding = mrfsat::Encoding::Variable;
+            i++;
+        } else if (arg == "--ordering" && i + 1 < argc && parseOrdering(argv[i + 1], options.ordering)) {
+            i++;
+        } else if (arg == "--preprocess") {
+            options.preprocess = true;
+        } else if (arg == "--coarsen-levels" && i + 1 < argc && parseInt(argv[i + 1], options.coarsen_levels)) {
+            options.coarsen_levels = std::max(options.coarsen_levels, 0);
+            i++;
+        } else if (arg == "--sweep" && i + 1 < argc && std::string(argv[i + 1]) == "full") {
+            options.full_sweep = true;
+            i++;
+        } else if (arg == "--sweep" && i + 1 < argc && std::string(argv[i + 1]) == "adaptive") {
+            options.full_sweep = false;
+            i++;
+        } else if (arg == "--memory-budget" && i + 1 < argc && parseSize(argv[i + 1], options.memory_budget)) {
+            i++;
+        } else if (arg == "--estimate") {
+            options.estimate = true;
+        } else if (arg == "--sparsify-epsilon" && i + 1 < argc && parseFloat(argv[i + 1], options.sparsify_epsilon)) {
+            i++;
+        } else if (arg == "--add-constraints" && i + 1 < argc) {
+            options.added_constraints = argv[++i];
+        } else if (arg == "--prefetch" && i + 1 < argc && parseInt(argv[i + 1], options.prefetch_depth)) {
+            options.prefetch_depth = std::max(options.prefetch_depth, 0);
+            i++;
+        } else if (arg == "--prefetch-memory" && i + 1 < argc && parseSize(argv[i + 1], options.prefetch_memory)) {
+            i++;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    std::vector<std::string> files = expandInputs(options.inputs);
+    if (files.empty() || (files.size() > 1 && !options.snapshot_name.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int status = 0;
+    if (options.estimate) {
+        // nothing is parsed, so there is nothing to read ahead
+        for (const std::string& file_name: files) {
+            try {
+                estimateInstance(file_name, options);
+            } catch (const std::exception& ex) {
+                std::cerr << file_name << ": " << ex.what() << std::endl;
+                status = 1;
+            }
+        }
+        return status;
+    }
+    mrfsat::Prefetcher prefetcher(files, options.prefetch_depth, options.prefetch_memory << 20);
+    while (prefetcher.hasNext()) {
+        mrfsat::PrefetchedFile file = prefetcher.next();
+        try {
+            if (!analyseInstance(file, options)) status = 1;
+        } catch (const std::exception& ex) {
+            std::cerr << file.file_name << ": " << ex.what() << std::endl;
+            status = 1;
+        }
+    }
+    return status;
 }
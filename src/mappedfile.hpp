@@ -0,0 +1,42 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace mrfsat {
+class MappedFile {
+    /*
+        Read-only memory mapping of a whole file. The mapping is released
+        when the object goes out of scope.
+    */
+    public:
+        MappedFile() : data_(nullptr), size_(0) {}
+        ~MappedFile() { close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        bool open(const std::string& file_name);
+        void close();
+        const char* begin() const { return data_; }
+        const char* end() const { return data_ + size_; }
+        size_t size() const { return size_; }
+    private:
+        char* data_;
+        size_t size_;
+};
+}
@@ -0,0 +1,838 @@
+/*
+Copyright (c) Lukas Esteban Gutierrez Lisboa
+
+Parts of the code were copied or adapted from Pseudoflow Parametric Maximum Flow Solver.
+
+The source code is subject to the following academic license. Note this is not an open source license.
+
+Copyright © 2001. The Regents of the University of California (Regents). All Rights Reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation for educational,
+research, and not-for-profit purposes, without fee and without a signed licensing agreement, is hereby granted, provided that the above copyright notice,
+this paragraph and the following two paragraphs appear in all copies, modifications, and distributions.
+Contact The Office of Technology Licensing, UC Berkeley, 2150 Shattuck Avenue, Suite 510, Berkeley, CA 94720-1620, (510) 643-7201,
+for commercial licensing opportunities.
+
+Created by Bala Chandran and Dorit S. Hochbaum, Department of Industrial Engineering and Operations Research, University of California, Berkeley.
+
+IN NO EVENT SHALL REGENTS BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF REGENTS HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+REGENTS SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". REGENTS HAS NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+*/
+
+
+
+#include "mrf/min_closure.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+
+static void
+initializeArc (Arc *ac)
+{
+	ac->from = 0;
+	ac->to = 0;
+	ac->capacity = 0;
+	ac->flow = 0;
+	ac->direction = 1;
+}
+
+static void
+initializeNode (Node *nd)
+{
+	nd->label = 0;
+	nd->excess = 0;
+	nd->parent = 0;
+	nd->childList = 0;
+	nd->nextScan = 0;
+	nd->next = 0;
+	nd->prev = 0;
+	nd->arcToParent = 0;
+}
+
+static void
+initializeNodeArcs (NodeArcs *na)
+{
+	na->outOfTree = NULL;
+	na->numOutOfTree = 0;
+	na->nextArc = 0;
+}
+
+static void
+initializeRoot (Node *nodes, Root *rt, const int sentinel)
+{
+	rt->start = sentinel;
+	rt->end = sentinel + 1;
+
+	initializeNode (&nodes[rt->start]);
+	initializeNode (&nodes[rt->end]);
+
+	nodes[rt->start].next = rt->end;
+	nodes[rt->end].prev = rt->start;
+}
+
+static inline void
+addToStrongBucket (Node *nodes, const int newRoot, const int rootEnd)
+{
+	nodes[newRoot].next = rootEnd;
+	nodes[newRoot].prev = nodes[rootEnd].prev;
+	nodes[rootEnd].prev = newRoot;
+	nodes[nodes[newRoot].prev].next = newRoot;
+}
+
+// Takes the root out of its strong bucket.
+static inline void
+removeFromStrongBucket (Node *nodes, const int strongRoot)
+{
+	nodes[nodes[strongRoot].next].prev = nodes[strongRoot].prev;
+	nodes[nodes[strongRoot].prev].next = nodes[strongRoot].next;
+}
+
+// Bytes of the arena a block of bytes takes, so that every block starts
+// on a 16 byte boundary.
+static int64_t
+arenaSize (int64_t bytes)
+{
+	return (bytes + 15) & ~(int64_t)15;
+}
+
+// Hands out the next bytes of the arena at *cursor.
+static void *
+carve (char **cursor, int64_t bytes)
+{
+	void *block = *cursor;
+	*cursor += arenaSize (bytes);
+	return block;
+}
+
+static void
+addOutOfTreeNode (NodeArcs *n, const int out)
+{
+	n->outOfTree[n->numOutOfTree] = out;
+	++ n->numOutOfTree;
+}
+
+static inline void
+addRelationship (Node *nodes, const int newParent, const int child)
+{
+	Node *nd = &nodes[child];
+
+	nd->parent = newParent;
+	nd->next = nodes[newParent].childList;
+	nd->prev = 0;
+	if (nd->next)
+	{
+		nodes[nd->next].prev = child;
+	}
+	nodes[newParent].childList = child;
+}
+
+static inline void
+breakRelationship (Node *nodes, const int oldParent, const int child)
+{
+	Node *nd = &nodes[child];
+
+	nd->parent = 0;
+
+	if (nd->prev)
+	{
+		nodes[nd->prev].next = nd->next;
+	}
+	else
+	{
+		nodes[oldParent].childList = nd->next;
+	}
+	if (nd->next)
+	{
+		nodes[nd->next].prev = nd->prev;
+	}
+	nd->next = 0;
+}
+
+// Slices 0 .. count is shared in among up to threads threads, when there
+// is enough to share.
+static int64_t parallelSlices(int64_t count, int threads) {
+	const int64_t MIN_SLICE = 1 << 14;
+	return std::max<int64_t>(std::min<int64_t>(threads, count / MIN_SLICE), 1);
+}
+
+template <typename Body>
+static void parallelRanges(int64_t count, int threads, Body body) {
+	int64_t slices = parallelSlices(count, threads);
+	if (slices <= 1) {
+		body(0, count);
+		return;
+	}
+	std::vector<std::thread> pool;
+	for (int64_t slice = 1; slice < slices; slice++) {
+		pool.emplace_back(body, count * slice / slices, count * (slice + 1) / slices);
+	}
+	body(0, count / slices);
+	for (std::thread& thread: pool) {
+		thread.join();
+	}
+}
+
+namespace mrfsat {
+
+void
+PseudoflowSolver::buildNetwork (const CSRGraph& graph, int graph_size,
+                                const float* sourceValues, const float* sinkValues, const float* lambdaVals,
+                                int params, bool out_of_core, int threads)
+{
+	int i = 0;
+	reset ();
+	numParams = params;
+	highestStrongLabel = 1;
+	numNodes = graph_size + 2;
+	numArcs = graph.edges();
+	numArcs += graph_size * 2;
+	terminalArcs = graph.edges();
+
+	// Every node has an arc slot for each arc it is an end of: two for an
+	// arc between nodes, and the source and the sink one for each node.
+	int64_t slots = 2 * graph.edges() + 4 * (int64_t)graph_size;
+	int64_t nodeCount = 1 + 3 * (int64_t)numNodes;
+	int64_t arcBytes = numArcs * (int64_t)sizeof (Arc);
+	int64_t terminalBytes = (2 * (int64_t)graph_size + numParams) * (int64_t)sizeof (float);
+	int64_t bytes = arenaSize (nodeCount * (int64_t)sizeof (Node)) +
+	                arenaSize ((numNodes + 1) * (int64_t)sizeof (NodeArcs)) +
+	                arenaSize (numNodes * (int64_t)sizeof (Root)) +
+	                arenaSize (numNodes * (int64_t)sizeof (int)) +
+	                arenaSize ((numNodes + 1) * (int64_t)sizeof (int)) +
+	                arenaSize ((slots + 1) * (int64_t)sizeof (int)) +
+	                arenaSize (terminalBytes) +
+	                arenaSize (numParams * (int64_t)sizeof (int));
+	if (!out_of_core) bytes += arenaSize (arcBytes);
+	if (bytes > arenaBytes)
+	{
+		free (arena);
+		arenaBytes = 0;
+		if ((arena = (char *) malloc (bytes)) == NULL) {
+			printf ("%s, %d: Could not allocate memory.\n", __FILE__, __LINE__);
+			exit (1);
+		}
+		arenaBytes = bytes;
+	}
+	char *cursor = arena;
+	adjacencyList = (Node *) carve (&cursor, nodeCount * sizeof (Node));
+	nodeArcs = (NodeArcs *) carve (&cursor, (numNodes + 1) * sizeof (NodeArcs));
+	strongRoots = (Root *) carve (&cursor, numNodes * sizeof (Root));
+	labelCount = (int *) carve (&cursor, numNodes * sizeof (int));
+	breakpoints = (int *) carve (&cursor, (numNodes + 1) * sizeof (int));
+	outOfTreeArcs = (int *) carve (&cursor, (slots + 1) * sizeof (int));
+	terminalBase = (float *) carve (&cursor, terminalBytes);
+	lambdas = terminalBase + 2 * graph_size;
+	changeParams = (int *) carve (&cursor, numParams * sizeof (int));
+	if (out_of_core)
+	{
+		// kept in a scratch file, and given back on the next reset
+		arcList = (Arc *) allocateScratch (arcBytes, true);
+		scratchNetwork = true;
+	}
+	else
+	{
+		arcList = (Arc *) carve (&cursor, arcBytes);
+	}
+
+	for (i=0; i <= numNodes; ++i) {
+		initializeNode (&adjacencyList[i]);
+		initializeNodeArcs (&nodeArcs[i]);
+		breakpoints[i] = (numParams+1);
+	}
+	for (i=0; i < numNodes; ++i) {
+		initializeRoot (adjacencyList, &strongRoots[i], numNodes + 1 + 2 * i);
+		labelCount[i] = 0;
+	}
+
+	source = numNodes - 1;
+	sink = numNodes;
+
+	// The arc of edge e is arcList[e], then come the source arcs and the
+	// sink arcs by node, so every range of rows or nodes can be filled on
+	// its own. Until the out-of-tree arrays are laid out, numOutOfTree
+	// counts the arcs of a node.
+	Arc *arcs = arcList;
+	int64_t edges = graph.edges();
+	int rows = graph.rows();
+
+	// arcs between nodes
+	bool shared = parallelSlices(rows, threads) > 1;
+	parallelRanges(rows, threads, [&](int64_t first, int64_t last) {
+		for (int key = first; key < last; key++) {
+			int out = graph.end(key) - graph.begin(key);
+			if (out == 0) continue;
+			if (shared) std::atomic_ref<int>(nodeArcs[key].numOutOfTree).fetch_add(out, std::memory_order_relaxed);
+			else nodeArcs[key].numOutOfTree += out;
+			for (int64_t edge = graph.begin(key); edge < graph.end(key); edge++) {
+				int adj_node = graph.neighbors[edge];
+				Arc *ac = &arcs[edge];
+				initializeArc (ac);
+				ac->from = key;
+				ac->to = adj_node;
+				if (shared) std::atomic_ref<int>(nodeArcs[adj_node].numOutOfTree).fetch_add(1, std::memory_order_relaxed);
+				else ++ nodeArcs[adj_node].numOutOfTree;
+			}
+		}
+	});
+
+	// source and sink arcs
+	parallelRanges(graph_size, threads, [&](int64_t first, int64_t last) {
+		for (int64_t node = first; node < last; node++) {
+			Arc *ac = &arcs[edges + node];
+			initializeArc (ac);
+			ac->from = source;
+			ac->to = node + 1;
+			ac = &arcs[edges + graph_size + node];
+			initializeArc (ac);
+			ac->from = node + 1;
+			ac->to = sink;
+			nodeArcs[node + 1].numOutOfTree += 2;
+		}
+	});
+	nodeArcs[source].numOutOfTree += graph_size;
+	nodeArcs[sink].numOutOfTree += graph_size;
+
+	// the values of the source arcs, then those of the sink arcs, and the
+	// lambda of each parameter, in the order they are swept
+	std::copy (sourceValues + 1, sourceValues + graph_size + 1, terminalBase);
+	std::copy (sinkValues + 1, sinkValues + graph_size + 1, terminalBase + graph_size);
+	std::reverse_copy (lambdaVals, lambdaVals + params, lambdas);
+
+	// Room for every arc a node has in one block. Out of the tree to start
+	// with are the arcs between nodes, from their first node, and the
+	// source and sink arcs, from the source and to the sink, each in the
+	// order of arcList.
+	slots = 0;
+	for (i=1; i<=numNodes; ++i)  {
+		nodeArcs[i].outOfTree = &outOfTreeArcs[slots];
+		slots += nodeArcs[i].numOutOfTree;
+		nodeArcs[i].numOutOfTree = 0;
+	}
+	parallelRanges(rows, threads, [&](int64_t first, int64_t last) {
+		for (int key = first; key < last; key++) {
+			for (int64_t edge = graph.begin(key); edge < graph.end(key); edge++) {
+				if (arcs[edge].to != arcs[edge].from) addOutOfTreeNode (&nodeArcs[key], edge);
+			}
+		}
+	});
+	for (i=0; i < graph_size; ++i) {
+		addOutOfTreeNode (&nodeArcs[source], edges + i);
+	}
+	for (i=0; i < graph_size; ++i) {
+		addOutOfTreeNode (&nodeArcs[sink], edges + graph_size + i);
+	}
+}
+
+void
+PseudoflowSolver::liftAll (int rootNode, const int theparam)
+{
+	Node *nodes = adjacencyList;
+	int temp, current=rootNode;
+
+	nodes[current].nextScan = nodes[current].childList;
+
+	-- labelCount[nodes[current].label];
+	nodes[current].label = numNodes;
+	breakpoints[current] = (theparam+1);
+
+	for ( ; (current); current = nodes[current].parent)
+	{
+		while (nodes[current].nextScan)
+		{
+			temp = nodes[current].nextScan;
+			nodes[current].nextScan = nodes[nodes[current].nextScan].next;
+			current = temp;
+			nodes[current].nextScan = nodes[current].childList;
+
+			-- labelCount[nodes[current].label];
+			nodes[current].label = numNodes;
+			breakpoints[current] = (theparam+1);
+		}
+	}
+}
+
+void
+PseudoflowSolver::simpleInitialization (void)
+{
+	int i, size;
+	Node *nodes = adjacencyList;
+	Arc *tempArc;
+
+	size = nodeArcs[source].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &arcList[nodeArcs[source].outOfTree[i]];
+		tempArc->flow = tempArc->capacity;
+		nodes[tempArc->to].excess += tempArc->capacity;
+	}
+
+	size = nodeArcs[sink].numOutOfTree;
+	for (i=0; i<size; ++i)
+	{
+		tempArc = &arcList[nodeArcs[sink].outOfTree[i]];
+		tempArc->flow = tempArc->capacity;
+		nodes[tempArc->from].excess -= tempArc->capacity;
+	}
+
+	nodes[source].excess = 0;
+	nodes[sink].excess = 0;
+
+	for (i=1; i<=numNodes; ++i) {
+		if (nodes[i].excess > 0)
+		{
+		    nodes[i].label = 1;
+			++ labelCount[1];
+
+			addToStrongBucket (nodes, i, strongRoots[1].end);
+		}
+	}
+
+	nodes[source].label = numNodes;
+	breakpoints[source] = 0;
+	nodes[sink].label = 0;
+	breakpoints[sink] = (numParams+2);
+	labelCount[0] = (numNodes - 2) - labelCount[1];
+}
+
+void
+PseudoflowSolver::merge (int parent, int child, int newArc)
+{
+	Node *nodes = adjacencyList;
+	int oldArc;
+	int current = child, oldParent, newParent = parent;
+
+#ifdef STATS
+	++ numMergers;
+#endif
+
+	while (nodes[current].parent)
+	{
+		oldArc = nodes[current].arcToParent;
+		nodes[current].arcToParent = newArc;
+		oldParent = nodes[current].parent;
+		breakRelationship (nodes, oldParent, current);
+		addRelationship (nodes, newParent, current);
+		newParent = current;
+		current = oldParent;
+		newArc = oldArc;
+		arcList[newArc].direction = 1 - arcList[newArc].direction;
+	}
+
+	nodes[current].arcToParent = newArc;
+	addRelationship (nodes, newParent, current);
+}
+
+
+inline void
+PseudoflowSolver::pushUpward (int currentArc, int child, int parent, const float resCap)
+{
+	Node *nodes = adjacencyList;
+	Arc *ac = &arcList[currentArc];
+
+#ifdef STATS
+	++ numPushes;
+#endif
+
+	if (resCap >= nodes[child].excess)
+	{
+		nodes[parent].excess += nodes[child].excess;
+		ac->flow += nodes[child].excess;
+		nodes[child].excess = 0;
+		return;
+	}
+
+	ac->direction = 0;
+	nodes[parent].excess += resCap;
+	nodes[child].excess -= resCap;
+	ac->flow = ac->capacity;
+	addOutOfTreeNode (&nodeArcs[parent], currentArc);
+	breakRelationship (nodes, parent, child);
+
+	addToStrongBucket (nodes, child, strongRoots[nodes[child].label].end);
+}
+
+
+inline void
+PseudoflowSolver::pushDownward (int currentArc, int child, int parent, float flow)
+{
+	Node *nodes = adjacencyList;
+	Arc *ac = &arcList[currentArc];
+
+#ifdef STATS
+	++ numPushes;
+#endif
+
+	if (flow >= nodes[child].excess)
+	{
+		nodes[parent].excess += nodes[child].excess;
+		ac->flow -= nodes[child].excess;
+		nodes[child].excess = 0;
+		return;
+	}
+
+	ac->direction = 1;
+	nodes[child].excess -= flow;
+	nodes[parent].excess += flow;
+	ac->flow = 0;
+	addOutOfTreeNode (&nodeArcs[parent], currentArc);
+	breakRelationship (nodes, parent, child);
+
+	addToStrongBucket (nodes, child, strongRoots[nodes[child].label].end);
+}
+
+void
+PseudoflowSolver::pushExcess (int strongRoot)
+{
+	Node *nodes = adjacencyList;
+	int current, parent;
+	Arc *arcToParent;
+
+	for (current = strongRoot; (nodes[current].excess && nodes[current].parent); current = parent)
+	{
+		parent = nodes[current].parent;
+		arcToParent = &arcList[nodes[current].arcToParent];
+		if (arcToParent->direction)
+		{
+			pushUpward (nodes[current].arcToParent, current, parent, (arcToParent->capacity - arcToParent->flow));
+		}
+		else
+		{
+			pushDownward (nodes[current].arcToParent, current, parent, arcToParent->flow);
+		}
+	}
+
+	if (nodes[current].excess > 0)
+	{
+		if (!nodes[current].next)
+		{
+			addToStrongBucket (nodes, current, strongRoots[nodes[current].label].end);
+		}
+	}
+}
+
+
+// Index of an out-of-tree arc of strongNode to a node of the label below,
+// which is taken out of its array, or -1.
+int
+PseudoflowSolver::findWeakNode (int strongNode, int *weakNode)
+{
+	Node *nodes = adjacencyList;
+	NodeArcs *nd = &nodeArcs[strongNode];
+	int i, size, out;
+	int weakLabel = highestStrongLabel - 1;
+
+	size = nd->numOutOfTree;
+
+	for (i=nd->nextArc; i<size; ++i)
+	{
+
+#ifdef STATS
+		++ numArcScans;
+#endif
+
+		out = nd->outOfTree[i];
+		if (nodes[arcList[out].to].label == weakLabel)
+		{
+			nd->nextArc = i;
+			(*weakNode) = arcList[out].to;
+			-- nd->numOutOfTree;
+			nd->outOfTree[i] = nd->outOfTree[nd->numOutOfTree];
+			return (out);
+		}
+		else if (nodes[arcList[out].from].label == weakLabel)
+		{
+			nd->nextArc = i;
+			(*weakNode) = arcList[out].from;
+			-- nd->numOutOfTree;
+			nd->outOfTree[i] = nd->outOfTree[nd->numOutOfTree];
+			return (out);
+		}
+	}
+
+	nd->nextArc = nd->numOutOfTree;
+
+	return -1;
+}
+
+
+void
+PseudoflowSolver::checkChildren (int curNode)
+{
+	Node *nodes = adjacencyList;
+	Node *nd = &nodes[curNode];
+
+	for ( ; (nd->nextScan); nd->nextScan = nodes[nd->nextScan].next)
+	{
+		if (nodes[nd->nextScan].label == nd->label)
+		{
+			return;
+		}
+
+	}
+
+	-- labelCount[nd->label];
+	++	nd->label;
+	++ labelCount[nd->label];
+
+#ifdef STATS
+	++ numRelabels;
+#endif
+
+	nodeArcs[curNode].nextArc = 0;
+}
+
+void
+PseudoflowSolver::processRoot (int strongRoot)
+{
+	Node *nodes = adjacencyList;
+	int temp, strongNode = strongRoot, weakNode;
+	int out;
+
+	nodes[strongRoot].nextScan = nodes[strongRoot].childList;
+
+	if ((out = findWeakNode (strongRoot, &weakNode)) >= 0)
+	{
+		merge (weakNode, strongNode, out);
+		pushExcess (strongRoot);
+		return;
+	}
+
+	checkChildren (strongRoot);
+
+	while (strongNode)
+	{
+		while (nodes[strongNode].nextScan)
+		{
+			temp = nodes[strongNode].nextScan;
+			nodes[strongNode].nextScan = nodes[nodes[strongNode].nextScan].next;
+			strongNode = temp;
+			nodes[strongNode].nextScan = nodes[strongNode].childList;
+
+			if ((out = findWeakNode (strongNode, &weakNode)) >= 0)
+			{
+				merge (weakNode, strongNode, out);
+				pushExcess (strongRoot);
+				return;
+			}
+
+			checkChildren (strongNode);
+		}
+
+		if ((strongNode = nodes[strongNode].parent))
+		{
+			checkChildren (strongNode);
+		}
+	}
+
+	addToStrongBucket (nodes, strongRoot, strongRoots[nodes[strongRoot].label].end);
+
+	++ highestStrongLabel;
+}
+
+int
+PseudoflowSolver::getHighestStrongRoot (const int theparam)
+{
+	Node *nodes = adjacencyList;
+	int i;
+	int strongRoot;
+
+	for (i=highestStrongLabel; i>0; --i)
+	{
+		if (nodes[strongRoots[i].start].next != strongRoots[i].end)
+		{
+			highestStrongLabel = i;
+			if (labelCount[i-1])
+			{
+				strongRoot = nodes[strongRoots[i].start].next;
+				removeFromStrongBucket (nodes, strongRoot);
+				nodes[strongRoot].next = 0;
+				return strongRoot;
+			}
+
+			while (nodes[strongRoots[i].start].next != strongRoots[i].end)
+			{
+
+#ifdef STATS
+				++ numGaps;
+#endif
+				strongRoot = nodes[strongRoots[i].start].next;
+				removeFromStrongBucket (nodes, strongRoot);
+				liftAll (strongRoot, theparam);
+			}
+		}
+	}
+
+	if (nodes[strongRoots[0].start].next == strongRoots[0].end)
+	{
+		return 0;
+	}
+
+	while (nodes[strongRoots[0].start].next != strongRoots[0].end)
+	{
+		strongRoot = nodes[strongRoots[0].start].next;
+		removeFromStrongBucket (nodes, strongRoot);
+
+		nodes[strongRoot].label = 1;
+		-- labelCount[0];
+		++ labelCount[1];
+
+#ifdef STATS
+		++ numRelabels;
+#endif
+
+		addToStrongBucket (nodes, strongRoot, strongRoots[nodes[strongRoot].label].end);
+	}
+
+	highestStrongLabel = 1;
+
+	strongRoot = nodes[strongRoots[1].start].next;
+	removeFromStrongBucket (nodes, strongRoot);
+	nodes[strongRoot].next = 0;
+
+	return strongRoot;
+}
+
+void
+PseudoflowSolver::updateCapacities (const int theparam)
+{
+	// The source and sink never enter a tree, so their out-of-tree arcs
+	// stay the terminal arcs as buildNetwork laid them out: the source arc
+	// of node i + 1 at terminalArcs + i and its sink arc graph_size further.
+	// They are walked in that order without going through the out-of-tree
+	// arrays or looking the node up from the arc.
+	Node *nodes = adjacencyList;
+	int i, graph_size = numNodes - 2;
+	float delta, capacity;
+	Arc *tempArc;
+	Arc *sourceArcs = &arcList[terminalArcs];
+	Arc *sinkArcs = sourceArcs + graph_size;
+	const float *sourceBase = terminalBase;
+	const float *sinkBase = terminalBase + graph_size;
+	const float lambda = lambdas[theparam];
+
+	for (i=0; i<graph_size; ++i)
+	{
+		tempArc = &sourceArcs[i];
+		capacity = std::max (sourceBase[i] - lambda, (float)0.0);
+		delta = (capacity - tempArc->capacity);
+		if (delta < 0)
+		{
+			printf ("c Error on source-adjacent arc (%d, %d): capacity decreases by %f at parameter %d.\n",
+				tempArc->from,
+				tempArc->to,
+				(-delta),
+				(theparam+1));
+			exit(0);
+		}
+
+		tempArc->capacity += delta;
+		tempArc->flow += delta;
+		nodes[i+1].excess += delta;
+
+		if ((nodes[i+1].label < numNodes) && (nodes[i+1].excess > 0))
+		{
+			pushExcess (i+1);
+		}
+	}
+
+	for (i=0; i<graph_size; ++i)
+	{
+		tempArc = &sinkArcs[i];
+		capacity = std::min (lambda - sinkBase[i], (float)0.0);
+		delta = (capacity - tempArc->capacity);
+		if (delta > 0)
+		{
+			printf ("c Error on sink-adjacent arc (%d, %d): capacity %f increases to %f at parameter %d.\n",
+				tempArc->from,
+				tempArc->to,
+				tempArc->capacity,
+				capacity,
+				(theparam+1));
+			exit(0);
+		}
+
+		tempArc->capacity += delta;
+		tempArc->flow += delta;
+		nodes[i+1].excess -= delta;
+
+		if ((nodes[i+1].label < numNodes) && (nodes[i+1].excess > 0))
+		{
+			pushExcess (i+1);
+		}
+	}
+
+	highestStrongLabel = (numNodes-1);
+}
+
+void
+PseudoflowSolver::pseudoflowPhase1 (const int *sweep, int count)
+{
+	int strongRoot;
+	int i, theparam = 0;
+
+	while ((strongRoot = getHighestStrongRoot (theparam)))
+	{
+		processRoot (strongRoot);
+	}
+
+	for (i=0; i < count; ++i)
+	{
+		theparam = sweep[i];
+		updateCapacities (theparam);
+		while ((strongRoot = getHighestStrongRoot (theparam)))
+		{
+			processRoot (strongRoot);
+		}
+	}
+}
+
+void
+PseudoflowSolver::solve (void)
+{
+	int i, count = 0;
+
+	// The sweep starts from no capacity at all rather than from those of
+	// parameter 0, so parameter 1 is always swept; past it, the capacities
+	// only change where the lambda does.
+	for (i=1; i < numParams; ++i) {
+		if (fullSweep || i == 1 || lambdas[i] != lambdas[i-1]) changeParams[count++] = i;
+	}
+	simpleInitialization ();
+	pseudoflowPhase1 (changeParams, count);
+	solvedParamCount = count + 1;
+}
+
+void
+PseudoflowSolver::reset (void)
+{
+	if (scratchNetwork)
+	{
+		freeScratch (arcList);
+		scratchNetwork = false;
+	}
+	adjacencyList = NULL;
+	nodeArcs = NULL;
+	strongRoots = NULL;
+	labelCount = NULL;
+	breakpoints = NULL;
+	arcList = NULL;
+	terminalBase = NULL;
+	lambdas = NULL;
+	changeParams = NULL;
+	outOfTreeArcs = NULL;
+	numNodes = 0;
+	numArcs = 0;
+}
+
+void
+PseudoflowSolver::freeMemory (void)
+{
+	reset ();
+	free (arena);
+	arena = NULL;
+	arenaBytes = 0;
+}
+}
@@ -0,0 +1,110 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "ordering.hpp"
+#include <algorithm>
+#include <numeric>
+
+
+namespace mrfsat {
+
+static std::vector<int> breadthFirst(const CSRGraph& graph, bool by_degree) {
+    // every component from its first node by id, or from a node of least
+    // degree with the neighbors taken by increasing degree for Cuthill-McKee
+    int nodes = std::max(graph.rows() - 1, 0);
+    auto degree = [&graph](int node) { return graph.end(node) - graph.begin(node); };
+    std::vector<int> starts(nodes);
+    std::iota(starts.begin(), starts.end(), 1);
+    if (by_degree) {
+        std::stable_sort(starts.begin(), starts.end(), [&](int a, int b) { return degree(a) < degree(b); });
+    }
+    std::vector<char> visited(nodes + 1, 0);
+    std::vector<int> order;
+    order.reserve(nodes);
+    std::vector<int> neighbors;
+    for (int start: starts) {
+        if (visited[start]) continue;
+        visited[start] = 1;
+        size_t head = order.size();
+        order.push_back(start);
+        for (; head < order.size(); head++) {
+            int node = order[head];
+            neighbors.clear();
+            for (int64_t edge = graph.begin(node); edge < graph.end(node); edge++) {
+                int neighbor = graph.neighbors[edge];
+                if (neighbor < 1 || neighbor > nodes || visited[neighbor]) continue;
+                visited[neighbor] = 1;
+                neighbors.push_back(neighbor);
+            }
+            if (by_degree) {
+                std::stable_sort(neighbors.begin(), neighbors.end(), [&](int a, int b) { return degree(a) < degree(b); });
+            }
+            order.insert(order.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+    if (by_degree) std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<int> nodeOrder(const CSRGraph& graph, NodeOrdering ordering) {
+    int nodes = std::max(graph.rows() - 1, 0);
+    std::vector<int> order(nodes);
+    std::iota(order.begin(), order.end(), 1);
+    switch (ordering) {
+        case NodeOrdering::Identity:
+            return order;
+        case NodeOrdering::BFS:
+            return breadthFirst(graph, false);
+        case NodeOrdering::ReverseCuthillMcKee:
+            return breadthFirst(graph, true);
+        case NodeOrdering::Degree:
+            std::stable_sort(order.begin(), order.end(), [&graph](int a, int b) {
+                return graph.end(a) - graph.begin(a) > graph.end(b) - graph.begin(b);
+            });
+            return order;
+    }
+    return order;
+}
+
+CSRGraph renumberNodes(const CSRGraph& graph, const std::vector<int>& order) {
+    std::vector<int> position(graph.rows(), 0);
+    for (size_t k = 0; k < order.size(); k++) {
+        position[order[k]] = k + 1;
+    }
+    CSRGraph renumbered;
+    renumbered.setOutOfCore(graph.outOfCore());
+    renumbered.offsets.assign(order.size() + 2, 0);
+    renumbered.neighbors.reserve(graph.edges());
+    renumbered.weights.reserve(graph.edges());
+    std::vector<std::pair<int, float> > row;
+    for (size_t k = 0; k < order.size(); k++) {
+        int node = order[k];
+        row.clear();
+        graph.forEachEdge(node, [&](int neighbor, float weight) {
+            row.emplace_back(position[neighbor], weight);
+        });
+        std::sort(row.begin(), row.end(),
+            [](const std::pair<int, float>& a, const std::pair<int, float>& b) { return a.first < b.first; });
+        for (const auto& [neighbor, weight]: row) {
+            renumbered.neighbors.push_back(neighbor);
+            renumbered.weights.push_back(weight);
+        }
+        renumbered.offsets[k + 2] = renumbered.neighbors.size();
+    }
+    return renumbered;
+}
+}
@@ -0,0 +1,39 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+
+#include <vector>
+#include "csrgraph.hpp"
+
+namespace mrfsat {
+
+/*
+    Order in which the nodes of a flow network are numbered: by id, in
+    breadth-first order, reverse Cuthill-McKee, or by decreasing degree.
+    The breakpoints do not depend on it, only the memory access pattern of
+    the solver does.
+*/
+enum class NodeOrdering { Identity, BFS, ReverseCuthillMcKee, Degree };
+
+// new position of nodes 1 .. rows() - 1 of graph: order[k] is the node
+// numbered k + 1
+std::vector<int> nodeOrder(const CSRGraph& graph, NodeOrdering ordering);
+
+// graph with node order[k] renumbered to k + 1, rows sorted by neighbor
+CSRGraph renumberNodes(const CSRGraph& graph, const std::vector<int>& order);
+}
@@ -0,0 +1,124 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "cnfparser.hpp"
+
+
+namespace mrfsat {
+
+void CNFParser::parseRegion(const char* buffer_begin, const char* buffer_end) {
+    base = buffer_begin;
+    cursor = buffer_begin;
+    end = buffer_end;
+    while (cursor < end && !stopped) {
+        //<formula> ::= <header> <clauses>
+        skipSpaces();
+        if (cursor == end) {
+            break;
+        }
+        char first = *cursor;
+        if (first == '\n') {
+            ++cursor;
+        } else if (first == 'c') {
+            skipLine();
+        } else if (first == 'p') {
+            getHeader();
+            skipLine();
+        } else if (first == '%') {
+            stopped = true;
+        } else {
+            getLiterals();
+        }
+    }
+}
+
+void CNFParser::finish() {
+    if (clause_open) {
+        // the last clause may omit its terminating 0
+        closeClause();
+    }
+    graph.setConstraintsNumber(clause_number - 1);
+    graph.updateLiteralsAmount(max_variable_id * 2);
+}
+
+void CNFParser::getHeader() {
+    //<header> ::= "p" "cnf" <integer> <integer>
+    ++cursor;
+    skipSpaces();
+    if (end - cursor < 3 || cursor[0] != 'c' || cursor[1] != 'n' || cursor[2] != 'f') {
+        syntaxError("expected p cnf header");
+    }
+    cursor += 3;
+    long variables = getInteger();
+    long clauses = getInteger();
+    if (variables > 0 && clauses > 0) {
+        graph.reserve(std::min(variables, MAX_DECLARED_SIZE), std::min(clauses, MAX_DECLARED_SIZE));
+    }
+}
+
+void CNFParser::getLiterals() {
+    //<clause> ::= <literals> "0", a clause may span several lines
+    while (true) {
+        skipSpaces();
+        if (cursor == end) {
+            return;
+        }
+        if (*cursor == '\n') {
+            ++cursor;
+            return;
+        }
+        long literal = getInteger();
+        if (literal == 0) {
+            closeClause();
+        } else {
+            addLiteral(static_cast<int>(literal));
+        }
+    }
+}
+
+long CNFParser::getInteger() {
+    //<literal> ::= <integer> | "-" <integer>
+    skipSpaces();
+    bool negative = peek() == '-';
+    if (negative) ++cursor;
+    if (static_cast<unsigned char>(peek() - '0') >= 10) {
+        syntaxError("expected an integer");
+    }
+    long number = 0;
+    while (cursor < end && static_cast<unsigned char>(*cursor - '0') < 10) {
+        number = number * 10 + (*cursor - '0');
+        ++cursor;
+    }
+    return negative ? -number : number;
+}
+
+void CNFParser::addLiteral(int literal) {
+    max_variable_id = std::max(std::abs(literal), max_variable_id);
+    if (literal < 0) {
+        negated_literals++;
+    }
+    graph.addVariableToConstraint(clause_number, std::pair<int, int> (literal, 1));
+    clause_open = true;
+}
+
+void CNFParser::closeClause() {
+    graph.addConstraintCoefficient(clause_number, 1 - negated_literals);
+    clause_number++;
+    negated_literals = 0;
+    clause_open = false;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <algorithm>
+#include "graph.hpp"
+#include "lexer.hpp"
+
+namespace mrfsat {
+class CNFParser : public Lexer {
+    /*
+        Grammar for DIMACS CNF files
+        <formula>      ::= <header> <clauses>
+        <header>       ::= "p" "cnf" <integer> <integer>
+        <clauses>      ::= <clause> | <clause> <clauses>
+        <clause>       ::= <literals> "0"
+        <literals>     ::= <literal> | <literal> <literals>
+        <literal>      ::= <integer> | "-" <integer>
+        <comment>      ::= "c"
+
+        Each clause becomes the constraint of its OPB translation, +1 x
+        for a positive literal and -1 x for a negated one, >= 1 minus the
+        number of negated literals. The graph is the same one OPBParser
+        builds from the translated file, e.g. test/3sat/aim-*.opb.
+        A line starting with "%" ends the formula, as in SATLIB files.
+    */
+    public:
+        CNFParser(Graph& g) : graph(g) {
+            clause_number = 1;
+            max_variable_id = 0;
+            negated_literals = 0;
+            clause_open = false;
+            stopped = false;
+        }
+    private:
+        void parseRegion(const char* begin, const char* end) override;
+        void finish() override;
+        // element parsers
+        void getHeader();
+        void getLiterals();
+        long getInteger();
+        void addLiteral(int literal);
+        void closeClause();
+        // parsing helpers
+        int clause_number;
+        int negated_literals;
+        bool clause_open;
+        bool stopped;
+        // graph
+        Graph& graph;
+        int max_variable_id;
+};
+}
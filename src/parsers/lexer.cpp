@@ -0,0 +1,87 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "lexer.hpp"
+#include <vector>
+#include <cstring>
+
+
+namespace mrfsat {
+
+// decompressed bytes handed to the parser at a time when streaming
+static const size_t STREAM_BUFFER_SIZE = 1 << 22;
+
+void Lexer::parseBuffer(const char* buffer_begin, const char* buffer_end) {
+    parseRegion(buffer_begin, buffer_end);
+    finish();
+}
+
+void Lexer::parseStream(InputStream& stream) {
+    std::vector<char> buffer(STREAM_BUFFER_SIZE);
+    size_t filled = 0;
+    bool done = false;
+    while (!done) {
+        if (filled == buffer.size()) {
+            // a single line does not fit, grow until it does
+            buffer.resize(buffer.size() * 2);
+        }
+        size_t n = stream.read(buffer.data() + filled, buffer.size() - filled);
+        done = n == 0;
+        filled += n;
+        const char* data = buffer.data();
+        const char* stop = data + filled;
+        if (!done) {
+            const void* last_newline = memrchr(data, '\n', filled);
+            stop = last_newline ? static_cast<const char*>(last_newline) + 1 : data;
+        }
+        if (stop == data) continue;
+        parseRegion(data, stop);
+        line_offset += std::count(data, stop, '\n');
+        filled -= stop - data;
+        std::memmove(buffer.data(), stop, filled);
+    }
+    finish();
+}
+
+void Lexer::skipSpaces() {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+        ++cursor;
+    }
+}
+
+void Lexer::skipLine() {
+    while (cursor < end && *cursor != '\n') {
+        ++cursor;
+    }
+    if (cursor < end) {
+        ++cursor;
+    }
+}
+
+void Lexer::syntaxError(const std::string& message) {
+    long line = line_offset + 1;
+    const char* line_start = base;
+    for (const char* position = base; position < cursor; ++position) {
+        if (*position == '\n') {
+            ++line;
+            line_start = position + 1;
+        }
+    }
+    throw std::invalid_argument("Syntax error at line " + std::to_string(line) + ", column " +
+                                std::to_string(cursor - line_start + 1) + ": " + message);
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include "inputstream.hpp"
+
+namespace mrfsat {
+class Lexer {
+    /*
+        Common base of the line oriented instance parsers. A parser gets
+        either the whole file as one buffer (mapped files) or successive
+        buffers of complete lines (streamed input), and reports syntax
+        errors as std::invalid_argument with the line and column counted
+        from the start of the input.
+    */
+    public:
+        Lexer() {
+            base = nullptr;
+            cursor = nullptr;
+            end = nullptr;
+            line_offset = 0;
+            threads = 1;
+        }
+        virtual ~Lexer() {}
+        void parseBuffer(const char* begin, const char* end);
+        void parseStream(InputStream& stream);
+        void setThreads(int n_threads) {threads = std::max(n_threads, 1);}
+    protected:
+        // parses the complete lines of [begin, end)
+        virtual void parseRegion(const char* begin, const char* end) = 0;
+        // called once after the last region
+        virtual void finish() = 0;
+        // lexing helpers
+        char peek() const { return cursor < end ? *cursor : '\0'; }
+        void skipSpaces();
+        void skipLine();
+        [[noreturn]] void syntaxError(const std::string& message);
+        // header sizes above this are not trusted for presizing
+        static constexpr long MAX_DECLARED_SIZE = 1 << 26;
+        const char* base;
+        const char* cursor;
+        const char* end;
+        long line_offset;
+        int threads;
+};
+}
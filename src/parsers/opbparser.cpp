@@ -15,124 +15,259 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "opbparser.hpp"
+#include <thread>
+#include <cstring>
 
 
 namespace mrfsat {
 
-void OPBParser::parseFile(std::ifstream &file_name) {
-    std::string line_stream;
-    while (std::getline(file_name, line_stream)) {
+// chunks smaller than this are not worth a thread
+static const size_t MIN_CHUNK_SIZE = 1 << 16;
+
+void OPBParser::finish() {
+    graph.setConstraintsNumber(line_number - 1);
+    graph.updateLiteralsAmount(max_variable_id * 2);
+}
+
+void OPBParser::parseRegion(const char* buffer_begin, const char* buffer_end) {
+    base = buffer_begin;
+    cursor = buffer_begin;
+    end = buffer_end;
+    if (!header_read) {
+        header_read = true;
+        getHeader();
+    }
+    if (threads > 1 && static_cast<size_t>(end - base) >= 2 * MIN_CHUNK_SIZE) {
+        parseParallel(buffer_begin, buffer_end);
+    } else {
+        parseLines();
+    }
+}
+
+void OPBParser::parseParallel(const char* buffer_begin, const char* buffer_end) {
+    size_t size = buffer_end - buffer_begin;
+    size_t n_chunks = std::min(static_cast<size_t>(threads), size / MIN_CHUNK_SIZE);
+    // every chunk ends right after a newline, so no equation is split
+    std::vector<const char*> bounds(1, buffer_begin);
+    for (size_t i = 1; i < n_chunks; i++) {
+        const char* bound = std::max(buffer_begin + size * i / n_chunks, bounds.back());
+        while (bound < buffer_end && *bound != '\n') ++bound;
+        if (bound < buffer_end) ++bound;
+        bounds.push_back(bound);
+    }
+    bounds.push_back(buffer_end);
+
+    std::vector<ParsedChunk> chunks(n_chunks);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < n_chunks; i++) {
+        workers.emplace_back([&, i]() {
+            OPBParser worker(graph);
+            worker.chunk = &chunks[i];
+            worker.base = buffer_begin;
+            worker.line_offset = line_offset;
+            worker.cursor = bounds[i];
+            worker.end = bounds[i + 1];
+            try {
+                worker.parseLines();
+            } catch (...) {
+                chunks[i].error = std::current_exception();
+            }
+            chunks[i].max_variable_id = worker.max_variable_id;
+        });
+    }
+    for (auto& worker: workers) {
+        worker.join();
+    }
+    for (auto& parsed: chunks) {
+        // the first failing chunk holds the first error of the file
+        if (parsed.error) std::rethrow_exception(parsed.error);
+        mergeChunk(parsed);
+        parsed = ParsedChunk();
+    }
+}
+
+void OPBParser::mergeChunk(ParsedChunk& parsed) {
+    size_t term = 0;
+    for (size_t i = 0; i < parsed.coefficients.size(); i++) {
+        for (; term < parsed.term_ends[i]; term++) {
+            graph.addVariableToConstraint(line_number, parsed.terms[term]);
+        }
+        graph.addConstraintCoefficient(line_number, parsed.coefficients[i]);
+        if (parsed.equalities[i]) {
+            graph.NormalizeEqualConstraint(line_number);
+        }
+        line_number++;
+    }
+    max_variable_id = std::max(max_variable_id, parsed.max_variable_id);
+}
+
+void OPBParser::addTerm(int variable, int coefficient) {
+    if (chunk) {
+        chunk->terms.emplace_back(variable, coefficient);
+    } else {
+        graph.addVariableToConstraint(line_number, std::pair<int, int> (variable, coefficient));
+    }
+}
+
+void OPBParser::addEquation(int constraint_coefficient, bool is_equality) {
+    if (chunk) {
+        chunk->term_ends.push_back(chunk->terms.size());
+        chunk->coefficients.push_back(constraint_coefficient);
+        chunk->equalities.push_back(is_equality);
+        return;
+    }
+    graph.addConstraintCoefficient(line_number, constraint_coefficient);
+    if (is_equality){
+        graph.NormalizeEqualConstraint(line_number);
+    }
+}
+
+void OPBParser::parseLines() {
+    while (cursor < end) {
         //<equations>  ::= <equation> | <equation> <equations>
-        line_stream.erase(std::remove(line_stream.begin(), line_stream.end(), ' '), line_stream.end());
-        if(line_stream[0] == '*') {
+        skipSpaces();
+        if (cursor == end) {
+            break;
+        }
+        char first = *cursor;
+        if (first == '\n') {
+            ++cursor;
             continue;
-        } else if (line_stream.length() == 0) {
+        } else if (first == '*') {
+            skipLine();
             continue;
-        } else if ("min:" == line_stream.substr(0, 4)) {
-           continue;
-        } else if ("max:" == line_stream.substr(0, 4)) {
+        } else if (startsWith("min:") || startsWith("max:")) {
+            skipLine();
             continue;
         }
-        stop = -1;
-        getEquation(line_stream);
+        getEquation();
         line_number++;
+        skipLine();
     }
-    graph.setConstraintsNumber(line_number - 1);
-    graph.updateLiteralsAmount(max_variable_id * 2);
 }
 
-void OPBParser::getEquation(std::string &line) {
-    //<equation> ::= <terms> <comparator> <integer> ";"
-    getTerms(line);
-    int compare_mode = getComparator(line);
-    int sign = 1;
-    try {
-        sign = getSign(line);   
-    } catch (std::out_of_range) {
-    }
-    int constraint_coefficient = sign * getInteger(line);
-    graph.addConstraintCoefficient(line_number, constraint_coefficient);
-    if (compare_mode == 1){
-        graph.NormalizeEqualConstraint(line_number);
+void OPBParser::getHeader() {
+    //<header> ::= "*" "#variable=" <integer> "#constraint=" <integer>
+    const char* start = cursor;
+    skipSpaces();
+    if (peek() == '*') {
+        const char* line_end = cursor;
+        while (line_end < end && *line_end != '\n') ++line_end;
+        long variables = getHeaderField(line_end, "#variable=");
+        long constraints = getHeaderField(line_end, "#constraint=");
+        if (variables > 0 && constraints > 0) {
+            graph.reserve(std::min(variables, MAX_DECLARED_SIZE), std::min(constraints, MAX_DECLARED_SIZE));
+        }
+    }
+    cursor = start;
+}
+
+long OPBParser::getHeaderField(const char* line_end, const char* field) {
+    // value of a "field= N" entry of the header line, -1 when missing
+    size_t field_length = std::strlen(field);
+    for (const char* position = cursor; position + field_length <= line_end; ++position) {
+        if (std::memcmp(position, field, field_length) == 0) {
+            position += field_length;
+            while (position < line_end && *position == ' ') ++position;
+            long value = 0;
+            int digits = 0;
+            for (; position < line_end && static_cast<unsigned char>(*position - '0') < 10 && digits < 18; ++position, ++digits) {
+                value = value * 10 + (*position - '0');
+            }
+            return digits > 0 ? value : -1;
+        }
     }
-    if (line[++stop] != ';') throw std::invalid_argument("Syntax error: expected ;"); 
+    return -1;
 }
 
-int OPBParser::getComparator(std::string &line) {
+void OPBParser::getEquation() {
+    //<equation> ::= <terms> <comparator> <integer> ";"
+    getTerms();
+    int compare_mode = getComparator();
+    int sign = getSign();
+    if (sign == 0) sign = 1;
+    int constraint_coefficient = sign * getInteger();
+    skipSpaces();
+    if (peek() != ';') syntaxError("expected ;");
+    ++cursor;
+    addEquation(constraint_coefficient, compare_mode == 1);
+}
+
+int OPBParser::getComparator() {
     //<comparator>   ::= "=" | ">="
-    if (line[++stop] == '=') {
+    skipSpaces();
+    if (peek() == '=') {
+        ++cursor;
         return 1;
-    } else if (line[stop] == '>' && line[stop + 1] == '=') {
-        stop++;
+    } else if (peek() == '>' && cursor + 1 < end && cursor[1] == '=') {
+        cursor += 2;
         return 0;
-    } else {
-        stop--;
-        throw std::invalid_argument("No support for non-linear constraints " + std::to_string(line_number)); 
     }
+    syntaxError("no support for non-linear constraints");
 }
 
-int OPBParser::getTerms(std::string &line) {
+void OPBParser::getTerms() {
     //<terms> ::= <term> | <term> <terms>
-    int term = 0;
-    while (term == 0) {
-        term = getTerm(line);
+    while (getTerm()) {
     }
-    return 0;
 }
 
-int OPBParser::getTerm(std::string &line) {
+bool OPBParser::getTerm() {
     //<term> ::= <sign> <integer> "x" <integer>
-    try {
-        int sign = getSign(line);
-        int coefficient = getInteger(line);
-        if (line[++stop] != 'x') throw std::invalid_argument("Syntax error: Term must have variable x.");
-        int variable = getInteger(line);
-        max_variable_id = std::max(variable, max_variable_id);
-        if (sign < 0){ 
-            variable = -1 * variable;
-        }
-        graph.addVariableToConstraint(line_number, std::pair<int, int> (variable, coefficient));
-        return 0;
-    } catch (std::out_of_range const& ex) {
-        return 1;
+    int sign = getSign();
+    if (sign == 0) {
+        return false;
+    }
+    int coefficient = getInteger();
+    skipSpaces();
+    if (peek() != 'x') syntaxError("term must have variable x");
+    ++cursor;
+    int variable = getInteger();
+    max_variable_id = std::max(variable, max_variable_id);
+    if (sign < 0){
+        variable = -1 * variable;
     }
+    addTerm(variable, coefficient);
+    return true;
 }
 
-int OPBParser::getSign(std::string &line) {
+int OPBParser::getSign() {
     //<sign> ::= "+" | "-"
-    int sign = 1;
-    if (line[++stop] == '-'){
-        sign = -1;
-    } else if (line[stop] == '+'){
-        sign = 1;
-    } else {
-        stop --;
-        throw std::out_of_range("No support for non-linear constraints. Expected +/-, received " + std::to_string(line_number));
+    // returns 0 when there is no sign, which ends a list of terms
+    skipSpaces();
+    if (peek() == '-') {
+        ++cursor;
+        return -1;
+    } else if (peek() == '+') {
+        ++cursor;
+        return 1;
     }
-    return sign;
+    return 0;
 }
 
-int OPBParser::getInteger(std::string &line) {
+int OPBParser::getInteger() {
     //<integer> ::= <digit> | <digit> <integer>
-    int digit = 0;
+    //<digit> ::= "0" | "1" | "2" | ... | "9"
+    skipSpaces();
     int number = 0;
-    while (digit != -10) {
-        digit = getDigit(line);
-        if (digit != -10) {
-            number = number * 10 + digit;
-        }
+    while (cursor < end && static_cast<unsigned char>(*cursor - '0') < 10) {
+        number = number * 10 + (*cursor - '0');
+        ++cursor;
     }
     return number;
 }
 
-int OPBParser::getDigit(std::string &line) { 
-    //<digit> ::= "0" | "1" | "2" | ... | "9"
-    std::set<char> digits = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
-    if (digits.find(line[++stop]) != digits.end()) {
-        return (int)(line[stop] - '0');
+bool OPBParser::startsWith(const char* keyword) {
+    // keywords may be spread with spaces, "min :" is accepted like "min:"
+    const char* position = cursor;
+    for (; *keyword; ++keyword) {
+        while (position < end && *position == ' ') ++position;
+        if (position == end || *position != *keyword) {
+            return false;
+        }
+        ++position;
     }
-    stop--;
-    return -10;
+    return true;
 }
 
 }
@@ -17,15 +17,26 @@
 
 #pragma once
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <algorithm>
 #include <stdexcept>
-#include <set>
+#include <exception>
+#include <vector>
 #include "graph.hpp"
+#include "lexer.hpp"
 
 namespace mrfsat {
-class OPBParser {
+struct ParsedChunk {
+    // equations of one chunk of the file, in file order
+    std::vector<std::pair<int, int> > terms;
+    std::vector<size_t> term_ends;
+    std::vector<int> coefficients;
+    std::vector<char> equalities;
+    int max_variable_id = 0;
+    std::exception_ptr error;
+};
+
+class OPBParser : public Lexer {
     /*
         BNF Grammar for OPB files
         <equations>    ::= <equation> | <equation> <equations>
@@ -37,27 +48,54 @@ class OPBParser {
         <integer>      ::= <digit> | <digit> <integer>
         <digit>        ::= "0" | "1" | "2" | ... | "9"
         <comment>      ::= "*"
+
+        The parser scans the raw file contents in a single pass, one line
+        per equation, without copying or allocating. Syntax errors are
+        reported as std::invalid_argument carrying the line and column.
+
+        With more than one thread the buffer is split at line boundaries,
+        every chunk is parsed into its own ParsedChunk and the chunks are
+        merged into the graph in file order, so constraint ids are the
+        same as in a sequential parse.
+
+        Streamed input (compressed files, stdin) is parsed one buffer of
+        complete lines at a time.
+
+        The "* #variable= N #constraint= M" header of normalized instances
+        is used to presize the graph before the first equation.
     */
     public:
         OPBParser(Graph& g) : graph(g) {
             line_number = 1;
             max_variable_id = 0;
+            chunk = nullptr;
+            header_read = false;
         }
-        void parseFile(std::ifstream &file_name);
     private:
+        void parseRegion(const char* begin, const char* end) override;
+        void finish() override;
+        void parseLines();
+        void parseParallel(const char* begin, const char* end);
+        void mergeChunk(ParsedChunk& parsed);
+        // equation sinks, either the graph or the chunk of a worker
+        void addTerm(int variable, int coefficient);
+        void addEquation(int constraint_coefficient, bool is_equality);
         // element parsers
-        void getEquation(std::string &line);
-        int getTerms(std::string &line);
-        int getTerm(std::string &line);
-        int getSign(std::string &line);
-        int getInteger(std::string &line);
-        int getComparator(std::string &line);
-        int getDigit(std::string &line);
+        void getHeader();
+        long getHeaderField(const char* line_end, const char* field);
+        void getEquation();
+        void getTerms();
+        bool getTerm();
+        int getSign();
+        int getInteger();
+        int getComparator();
+        bool startsWith(const char* keyword);
         // parsing helpers
-        int stop;
         int line_number;
         // graph
         Graph& graph;
+        ParsedChunk* chunk;
         int max_variable_id;
+        bool header_read;
 };
 }
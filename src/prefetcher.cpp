@@ -0,0 +1,345 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "prefetcher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define MRFSAT_IO_URING
+#endif
+
+
+namespace mrfsat {
+
+// largest single read request, the kernel caps reads just below 2GiB
+static const size_t MAX_READ_SIZE = 1 << 30;
+
+struct Prefetcher::Slot {
+    int fd = -1;
+    std::unique_ptr<char[]> buffer;
+    size_t size = 0;
+    size_t done = 0;
+    bool opened = false;
+    bool pending = false;
+    bool loaded = false;
+};
+
+class Prefetcher::IoRing {
+    /*
+        Minimal io_uring submission and completion queue, driven through
+        the raw system calls so no liburing is needed. Only the
+        prefetcher thread touches it.
+    */
+    public:
+        static std::unique_ptr<IoRing> create(unsigned entries);
+        ~IoRing();
+        bool submitRead(int fd, char* buffer, unsigned size, uint64_t offset, uint64_t user_data);
+        bool wait(uint64_t& user_data, int& result);
+        // reads the kernel has taken whose completion is not reaped yet
+        unsigned inFlight() const;
+    private:
+#ifdef MRFSAT_IO_URING
+        int ring_fd = -1;
+        unsigned in_flight = 0;
+        unsigned sq_entries = 0;
+        unsigned* sq_head = nullptr;
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        void* sq_ring = MAP_FAILED;
+        size_t sq_ring_size = 0;
+        void* cq_ring = MAP_FAILED;
+        size_t cq_ring_size = 0;
+        size_t sqes_size = 0;
+#endif
+};
+
+#ifdef MRFSAT_IO_URING
+std::unique_ptr<Prefetcher::IoRing> Prefetcher::IoRing::create(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        // not supported by the kernel or blocked by a seccomp profile
+        return nullptr;
+    }
+    std::unique_ptr<IoRing> ring(new IoRing());
+    ring->ring_fd = fd;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+    }
+    ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) return nullptr;
+    if (single_mmap) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) return nullptr;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return nullptr;
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(ring->sq_ring);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(ring->cq_ring);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return ring;
+}
+
+Prefetcher::IoRing::~IoRing() {
+    if (sqes != nullptr) munmap(sqes, sqes_size);
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+    if (ring_fd >= 0) close(ring_fd);
+}
+
+bool Prefetcher::IoRing::submitRead(int fd, char* buffer, unsigned size, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *sq_tail;
+    if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        return false;
+    }
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0) < 0) {
+        if (errno == EINTR) continue;
+        // without SQPOLL the kernel only takes entries inside the call, so
+        // one it left behind can be taken back and its buffer reused
+        if (__atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == tail) {
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            return false;
+        }
+        break;
+    }
+    in_flight++;
+    return true;
+}
+
+bool Prefetcher::IoRing::wait(uint64_t& user_data, int& result) {
+    while (true) {
+        unsigned head = *cq_head;
+        if (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe* cqe = &cqes[head & *cq_mask];
+            user_data = cqe->user_data;
+            result = cqe->res;
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            in_flight--;
+            return true;
+        }
+        if (syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+unsigned Prefetcher::IoRing::inFlight() const {
+    return in_flight;
+}
+#else
+std::unique_ptr<Prefetcher::IoRing> Prefetcher::IoRing::create(unsigned) {
+    return nullptr;
+}
+
+Prefetcher::IoRing::~IoRing() {}
+
+bool Prefetcher::IoRing::submitRead(int, char*, unsigned, uint64_t, uint64_t) {
+    return false;
+}
+
+bool Prefetcher::IoRing::wait(uint64_t&, int&) {
+    return false;
+}
+
+unsigned Prefetcher::IoRing::inFlight() const {
+    return 0;
+}
+#endif
+
+Prefetcher::Prefetcher(const std::vector<std::string>& file_names, int prefetch_depth, size_t budget)
+    : files(file_names), slots(file_names.size()), next_index(0), submit_index(0),
+      depth(std::max(prefetch_depth, 0)), memory_budget(budget), memory_in_flight(0) {
+    if (depth > 0) {
+        unsigned entries = 8;
+        while (entries < 2 * depth) entries *= 2;
+        ring = IoRing::create(entries);
+    }
+    submitAhead();
+}
+
+Prefetcher::~Prefetcher() {
+    // reads still in flight write into the slot buffers, wait for them
+    for (size_t i = next_index; i < submit_index; i++) {
+        waitFor(i);
+    }
+    for (auto& slot: slots) {
+        if (slot && slot->fd >= 0) close(slot->fd);
+    }
+}
+
+void Prefetcher::submitAhead() {
+    while (submit_index < files.size() && submit_index < next_index + depth) {
+        if (!submit(submit_index)) {
+            // out of buffer memory until the current file is taken
+            break;
+        }
+        submit_index++;
+    }
+}
+
+bool Prefetcher::submit(size_t index) {
+    if (!slots[index]) slots[index] = std::make_unique<Slot>();
+    Slot& slot = *slots[index];
+    if (!slot.opened) {
+        slot.opened = true;
+        slot.fd = open(files[index].c_str(), O_RDONLY);
+        struct stat file_stat;
+        if (slot.fd < 0 || fstat(slot.fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            // left to the regular reader, which reports the error
+            if (slot.fd >= 0) close(slot.fd);
+            slot.fd = -1;
+            return true;
+        }
+        slot.size = file_stat.st_size;
+    }
+    bool fits = slot.size > 0 && slot.size <= memory_budget;
+    if (ring && fits) {
+        if (memory_in_flight + slot.size > memory_budget && memory_in_flight > 0) {
+            return false;
+        }
+        slot.buffer.reset(new char[slot.size]);
+        unsigned size = std::min(slot.size, MAX_READ_SIZE);
+        if (ring->submitRead(slot.fd, slot.buffer.get(), size, 0, index)) {
+            slot.pending = true;
+            memory_in_flight += slot.size;
+            return true;
+        }
+        slot.buffer.reset();
+    }
+    posix_fadvise(slot.fd, 0, 0, POSIX_FADV_WILLNEED);
+    readahead(slot.fd, 0, slot.size);
+    close(slot.fd);
+    slot.fd = -1;
+    return true;
+}
+
+void Prefetcher::waitFor(size_t index) {
+    Slot& target = *slots[index];
+    while (target.pending) {
+        uint64_t user_data;
+        int result;
+        if (!ring->wait(user_data, result)) {
+            // the ring broke, every pending file falls back to a plain read
+            dropRing();
+            return;
+        }
+        Slot& slot = *slots[user_data];
+        if (result < 0) {
+            slot.pending = false;
+            continue;
+        }
+        slot.done += result;
+        if (result == 0 || slot.done == slot.size) {
+            slot.pending = false;
+            slot.loaded = slot.done == slot.size;
+            continue;
+        }
+        // short read, ask for the rest
+        unsigned size = std::min(slot.size - slot.done, MAX_READ_SIZE);
+        if (!ring->submitRead(slot.fd, slot.buffer.get() + slot.done, size, slot.done, user_data)) {
+            slot.pending = false;
+        }
+    }
+}
+
+void Prefetcher::dropRing() {
+    // Reads the kernel has taken may still write into their buffers, so
+    // they are reaped before the ring is closed and the buffers can go.
+    // Should the ring fail at that too, the buffers of the reads left are
+    // never freed rather than freed under the kernel.
+    uint64_t user_data;
+    int result;
+    while (ring->inFlight() > 0 && ring->wait(user_data, result)) {}
+    bool drained = ring->inFlight() == 0;
+    ring.reset();
+    for (auto& slot: slots) {
+        if (!slot || !slot->pending) continue;
+        slot->pending = false;
+        if (!drained) {
+            memory_in_flight -= slot->size;
+            slot->buffer.release();
+        }
+    }
+}
+
+PrefetchedFile Prefetcher::next() {
+    if (submit_index == next_index) {
+        // nothing ahead, e.g. a depth of 0, read the file now
+        submit(next_index);
+        submit_index++;
+    }
+    size_t index = next_index++;
+    Slot& slot = *slots[index];
+    waitFor(index);
+    PrefetchedFile file;
+    file.file_name = files[index];
+    if (slot.buffer) {
+        memory_in_flight -= slot.size;
+    }
+    if (slot.loaded) {
+        file.contents = std::move(slot.buffer);
+        file.size = slot.size;
+        file.loaded = true;
+    }
+    if (slot.fd >= 0) close(slot.fd);
+    slots[index].reset();
+    submitAhead();
+    return file;
+}
+}
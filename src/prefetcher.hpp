@@ -0,0 +1,69 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace mrfsat {
+struct PrefetchedFile {
+    std::string file_name;
+    // whole file contents, only when loaded is true
+    std::unique_ptr<char[]> contents;
+    size_t size = 0;
+    bool loaded = false;
+};
+
+class Prefetcher {
+    /*
+        Reads the instance files of a batch ahead of the one being
+        analysed, so that the disk works while the solver runs. Up to
+        depth files are in flight at a time, holding at most
+        memory_budget bytes of buffers. Reads go through io_uring when
+        the kernel allows it; otherwise, and for files that do not fit
+        the budget, the kernel is only asked to read the file into the
+        page cache (posix_fadvise and readahead) and the file is not
+        loaded.
+    */
+    public:
+        Prefetcher(const std::vector<std::string>& file_names, int depth, size_t memory_budget);
+        ~Prefetcher();
+        Prefetcher(const Prefetcher&) = delete;
+        Prefetcher& operator=(const Prefetcher&) = delete;
+        bool hasNext() const { return next_index < files.size(); }
+        // waits for the next file of the batch, in order
+        PrefetchedFile next();
+        bool usesIoRing() const { return ring != nullptr; }
+    private:
+        struct Slot;
+        class IoRing;
+        void submitAhead();
+        bool submit(size_t index);
+        void waitFor(size_t index);
+        void dropRing();
+        std::vector<std::string> files;
+        std::vector<std::unique_ptr<Slot> > slots;
+        std::unique_ptr<IoRing> ring;
+        size_t next_index;
+        size_t submit_index;
+        size_t depth;
+        size_t memory_budget;
+        size_t memory_in_flight;
+};
+}
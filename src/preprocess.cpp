@@ -0,0 +1,253 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "graph.hpp"
+#include <unordered_map>
+
+
+namespace mrfsat {
+/*
+    A constraint reads  sum sign(l) * c * x_|l|  >= rhs  over 0/1 variables,
+    or = rhs when it is equalized; the sign of a literal is the sign its
+    coefficient had in the instance. Bounds are taken term by term, which
+    stays sound when a variable occurs with both signs in one constraint.
+*/
+static long long termValue(const std::pair<int, int>& term) {
+    return term.first < 0 ? -(long long)term.second : (long long)term.second;
+}
+
+PreprocessStats Graph::preprocess() {
+    PreprocessStats stats;
+    if (built) {
+        // a snapshot has no constraints left to simplify
+        return stats;
+    }
+    mergeRepeatedLiterals();
+    int ids = constraint_terms.size();
+    int variables = n_lits / 2 + 1;
+    std::vector<char> live(ids, 0);
+    for (int constraint = 0; constraint < ids; constraint++) {
+        if (constraint_terms[constraint].empty()) continue;
+        live[constraint] = 1;
+        stats.constraints_before++;
+        stats.terms_before += constraint_terms[constraint].size();
+        for (auto& [literal, coefficient]: constraint_terms[constraint]) {
+            variables = std::max(variables, std::abs(literal) + 1);
+        }
+    }
+    stats.constraints_after = stats.constraints_before;
+    stats.terms_after = stats.terms_before;
+    if ((int)constraint_coefficients.size() < ids) constraint_coefficients.resize(ids, 0);
+
+    // unit propagation: a term that the constraint cannot do without is
+    // fixed to the value that maximizes it (or minimizes it, for the upper
+    // side of an equality), until nothing changes
+    std::vector<signed char> value(variables, -1);
+    std::vector<std::vector<int> > occurrences(variables);
+    for (int constraint = 0; constraint < ids; constraint++) {
+        for (auto& [literal, coefficient]: constraint_terms[constraint]) {
+            occurrences[std::abs(literal)].push_back(constraint);
+        }
+    }
+    std::vector<int> queue;
+    std::vector<char> queued(ids, 0);
+    for (int constraint = ids - 1; constraint >= 0; constraint--) {
+        if (!live[constraint]) continue;
+        queue.push_back(constraint);
+        queued[constraint] = 1;
+    }
+    auto assign = [&](int variable, int new_value) {
+        if (value[variable] >= 0) return value[variable] == new_value;
+        value[variable] = new_value;
+        stats.fixed_variables++;
+        for (int constraint: occurrences[variable]) {
+            if (queued[constraint]) continue;
+            queue.push_back(constraint);
+            queued[constraint] = 1;
+        }
+        return true;
+    };
+    while (!queue.empty() && !stats.conflict) {
+        int constraint = queue.back();
+        queue.pop_back();
+        queued[constraint] = 0;
+        const ConstraintTerms& terms = constraint_terms[constraint];
+        long long fixed = 0, highest = 0, lowest = 0;
+        for (const auto& term: terms) {
+            long long a = termValue(term);
+            int current = value[std::abs(term.first)];
+            if (current >= 0) fixed += a * current;
+            else if (a > 0) highest += a;
+            else lowest += a;
+        }
+        long long rhs = constraint_coefficients[constraint];
+        long long above = fixed + highest - rhs;
+        long long below = rhs - fixed - lowest;
+        bool equalized = isEqualized(constraint);
+        if (above < 0 || (equalized && below < 0)) {
+            stats.conflict = true;
+            break;
+        }
+        for (const auto& term: terms) {
+            long long a = termValue(term);
+            int variable = std::abs(term.first);
+            if (value[variable] >= 0) continue;
+            bool consistent = true;
+            if (std::abs(a) > above) consistent = assign(variable, a > 0 ? 1 : 0);
+            if (consistent && equalized && std::abs(a) > below) consistent = assign(variable, a > 0 ? 0 : 1);
+            if (!consistent) {
+                stats.conflict = true;
+                break;
+            }
+        }
+    }
+    if (stats.conflict) {
+        stats.fixed_variables = 0;
+        return stats;
+    }
+    occurrences = std::vector<std::vector<int> >();
+
+    auto substitute = [&]() {
+        for (int constraint = 0; constraint < ids; constraint++) {
+            if (!live[constraint]) continue;
+            ConstraintTerms& terms = constraint_terms[constraint];
+            long long rhs = constraint_coefficients[constraint];
+            size_t kept = 0;
+            for (const auto& term: terms) {
+                int current = value[std::abs(term.first)];
+                if (current >= 0) rhs -= termValue(term) * current;
+                else terms[kept++] = term;
+            }
+            terms.resize(kept);
+            constraint_coefficients[constraint] = static_cast<int>(rhs);
+        }
+    };
+    std::vector<char> removed(ids, 0);
+    auto remove = [&](int constraint) {
+        ConstraintTerms().swap(constraint_terms[constraint]);
+        if (isEqualized(constraint)) {
+            normalization_marks[constraint] = 0;
+            to_normalize_amount--;
+        }
+        live[constraint] = 0;
+        removed[constraint] = 1;
+    };
+
+    // drop what every assignment satisfies, which may leave literals of a
+    // single sign; fixing those only helps the constraints they are in
+    substitute();
+    while (true) {
+        for (int constraint = 0; constraint < ids; constraint++) {
+            if (!live[constraint]) continue;
+            long long highest = 0, lowest = 0;
+            for (const auto& term: constraint_terms[constraint]) {
+                long long a = termValue(term);
+                if (a > 0) highest += a;
+                else lowest += a;
+            }
+            long long rhs = constraint_coefficients[constraint];
+            bool satisfied = isEqualized(constraint) ? lowest == rhs && highest == rhs : lowest >= rhs;
+            if (satisfied) {
+                remove(constraint);
+                stats.satisfied_constraints++;
+            }
+        }
+        std::vector<char> signs(variables, 0);
+        for (int constraint = 0; constraint < ids; constraint++) {
+            if (!live[constraint]) continue;
+            bool equalized = isEqualized(constraint);
+            for (const auto& term: constraint_terms[constraint]) {
+                long long a = termValue(term);
+                if (a == 0) continue;
+                signs[std::abs(term.first)] |= equalized ? 3 : (a > 0 ? 1 : 2);
+            }
+        }
+        int64_t pure = 0;
+        for (int variable = 0; variable < variables; variable++) {
+            if (value[variable] >= 0 || (signs[variable] != 1 && signs[variable] != 2)) continue;
+            value[variable] = signs[variable] == 1 ? 1 : 0;
+            pure++;
+        }
+        if (pure == 0) break;
+        stats.pure_literals += pure;
+        substitute();
+    }
+
+    // duplicates keep the first constraint in file order
+    std::unordered_map<uint64_t, std::vector<int> > seen;
+    for (int constraint = 0; constraint < ids; constraint++) {
+        if (!live[constraint]) continue;
+        const ConstraintTerms& terms = constraint_terms[constraint];
+        bool equalized = isEqualized(constraint);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&hash](uint64_t word) { hash = (hash ^ word) * 0x100000001b3ULL; };
+        mix(equalized);
+        mix(static_cast<uint32_t>(constraint_coefficients[constraint]));
+        for (const auto& [literal, coefficient]: terms) {
+            mix(static_cast<uint32_t>(literal));
+            mix(static_cast<uint32_t>(coefficient));
+        }
+        std::vector<int>& bucket = seen[hash];
+        bool duplicate = false;
+        for (int other: bucket) {
+            if (constraint_terms[other] == terms && isEqualized(other) == equalized &&
+                constraint_coefficients[other] == constraint_coefficients[constraint]) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            remove(constraint);
+            stats.duplicate_constraints++;
+        } else {
+            bucket.push_back(constraint);
+        }
+    }
+    seen = std::unordered_map<uint64_t, std::vector<int> >();
+
+    // close the gaps so removed constraints leave no nodes behind
+    size_t length = std::max({constraint_terms.size(), constraint_coefficients.size(), normalization_marks.size()});
+    constraint_terms.resize(length);
+    constraint_coefficients.resize(length, 0);
+    normalization_marks.resize(length, 0);
+    int64_t removed_before = 0;
+    for (size_t constraint = 0; constraint < length; constraint++) {
+        if (constraint < removed.size() && removed[constraint]) {
+            removed_before++;
+            continue;
+        }
+        if (removed_before == 0) continue;
+        size_t target = constraint - removed_before;
+        constraint_terms[target] = std::move(constraint_terms[constraint]);
+        constraint_coefficients[target] = constraint_coefficients[constraint];
+        normalization_marks[target] = normalization_marks[constraint];
+    }
+    constraint_terms.resize(length - removed_before);
+    constraint_coefficients.resize(length - removed_before);
+    normalization_marks.resize(length - removed_before);
+    n_constraints -= removed_before;
+
+    stats.constraints_after = 0;
+    stats.terms_after = 0;
+    for (const ConstraintTerms& terms: constraint_terms) {
+        if (terms.empty()) continue;
+        stats.constraints_after++;
+        stats.terms_after += terms.size();
+    }
+    return stats;
+}
+}
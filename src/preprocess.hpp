@@ -0,0 +1,40 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+
+#include <cstdint>
+
+namespace mrfsat {
+
+struct PreprocessStats {
+    /*
+        What Graph::preprocess removed. Constraint and term counts are over
+        constraints that have terms. On a conflict the instance is
+        unsatisfiable by propagation alone and is left as it was.
+    */
+    int64_t constraints_before = 0;
+    int64_t constraints_after = 0;
+    int64_t terms_before = 0;
+    int64_t terms_after = 0;
+    int64_t duplicate_constraints = 0;
+    int64_t satisfied_constraints = 0;
+    int64_t fixed_variables = 0;
+    int64_t pure_literals = 0;
+    bool conflict = false;
+};
+}
@@ -0,0 +1,78 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "scratch.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace mrfsat {
+
+// blocks smaller than this stay on the heap even out of core
+static const size_t MIN_MAPPED_BYTES = 1 << 20;
+
+struct ScratchHeader {
+    uint64_t size;
+    uint64_t mapped;
+};
+
+static void* mapScratchFile(size_t size) {
+    const char* directory = std::getenv("TMPDIR");
+    std::string name = std::string(directory && *directory ? directory : "/tmp") + "/mrfsat-XXXXXX";
+    int fd = mkstemp(&name[0]);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create scratch file " + name);
+    }
+    unlink(name.c_str());
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + std::to_string(size) + " bytes of scratch file " + name);
+    }
+    return mapped;
+}
+
+void* allocateScratch(size_t bytes, bool out_of_core) {
+    size_t size = bytes + sizeof(ScratchHeader);
+    bool mapped = out_of_core && bytes >= MIN_MAPPED_BYTES;
+    void* block = mapped ? mapScratchFile(size) : std::malloc(size);
+    if (block == nullptr) throw std::bad_alloc();
+    ScratchHeader* header = static_cast<ScratchHeader*>(block);
+    header->size = size;
+    header->mapped = mapped;
+    return header + 1;
+}
+
+void freeScratch(void* block) {
+    if (block == nullptr) return;
+    ScratchHeader* header = static_cast<ScratchHeader*>(block) - 1;
+    if (header->mapped) {
+        munmap(header, header->size);
+    } else {
+        std::free(header);
+    }
+}
+}
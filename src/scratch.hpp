@@ -0,0 +1,60 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace mrfsat {
+
+/*
+    Memory for the large arrays of the graph and of the flow networks. Out
+    of core, a block is a shared mapping of an unlinked file in $TMPDIR (or
+    /tmp), which the kernel writes back to disk under memory pressure
+    instead of the process being killed. Every block records how it was
+    made, so freeScratch gives back either kind.
+*/
+void* allocateScratch(size_t bytes, bool out_of_core);
+void freeScratch(void* block);
+
+template <typename T>
+struct ScratchAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    // where blocks allocated from now on go, any block can be freed
+    bool out_of_core = false;
+
+    ScratchAllocator() = default;
+    explicit ScratchAllocator(bool on_disk) : out_of_core(on_disk) {}
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other) : out_of_core(other.out_of_core) {}
+    T* allocate(size_t n) { return static_cast<T*>(allocateScratch(n * sizeof(T), out_of_core)); }
+    void deallocate(T* block, size_t) { freeScratch(block); }
+    template <typename U>
+    bool operator==(const ScratchAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const ScratchAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T> >;
+}
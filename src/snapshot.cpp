@@ -0,0 +1,147 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "graph.hpp"
+#include "snapshot.hpp"
+#include <fstream>
+#include <stdexcept>
+
+
+namespace mrfsat {
+
+uint64_t snapshotChecksum(const char* data, size_t size) {
+    // FNV-1a over 8 byte words, then over the remaining bytes
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    return hash;
+}
+
+void Graph::saveSnapshot(const std::string& file_name) {
+    std::string payload;
+    auto append = [&payload](const void* data, size_t size) {
+        payload.append(static_cast<const char*>(data), size);
+        payload.append(snapshotPadding(size), '\0');
+    };
+    std::vector<int64_t> offsets = csr_graph.offsets;
+    if (offsets.empty()) offsets.push_back(0);
+    append(offsets.data(), offsets.size() * sizeof(int64_t));
+    append(csr_graph.neighbors.data(), csr_graph.neighbors.size() * sizeof(int32_t));
+    // the format keeps a weight for every edge
+    std::vector<float> weights;
+    weights.reserve(csr_graph.edges());
+    for (int node = 0; node < csr_graph.rows(); node++) {
+        csr_graph.forEachEdge(node, [&weights](int, float weight) { weights.push_back(weight); });
+    }
+    append(weights.data(), weights.size() * sizeof(float));
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.n_lits = n_lits;
+    header.n_constraints = n_constraints;
+    header.n_rows = offsets.size() - 1;
+    header.n_edges = csr_graph.edges();
+    header.checksum = snapshotChecksum(payload.data(), payload.size());
+    header.encoding = static_cast<uint32_t>(encoding);
+
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    if (!file) {
+        throw std::runtime_error("Could not write snapshot " + file_name);
+    }
+}
+
+void Graph::loadSnapshot(const char* begin, const char* end) {
+    size_t size = end - begin;
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Truncated snapshot");
+    }
+    std::memcpy(&header, begin, sizeof(header));
+    if (!isSnapshot(begin, size) || header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        throw std::runtime_error("Not a snapshot of this platform");
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version) +
+                                 ", save it again with this version");
+    }
+    if (header.encoding > static_cast<uint32_t>(Encoding::Variable)) {
+        throw std::runtime_error("Corrupted snapshot");
+    }
+    if (header.n_rows < 0 || header.n_edges < 0 || header.n_rows > INT32_MAX) {
+        throw std::runtime_error("Corrupted snapshot");
+    }
+    size_t offsets_size = (header.n_rows + 1) * sizeof(int64_t);
+    size_t neighbors_size = header.n_edges * sizeof(int32_t);
+    size_t weights_size = header.n_edges * sizeof(float);
+    size_t payload_size = offsets_size + snapshotPadding(offsets_size) + neighbors_size + snapshotPadding(neighbors_size) +
+                          weights_size + snapshotPadding(weights_size);
+    const char* payload = begin + sizeof(header);
+    if (size - sizeof(header) != payload_size) {
+        throw std::runtime_error("Truncated snapshot");
+    }
+    if (snapshotChecksum(payload, payload_size) != header.checksum) {
+        throw std::runtime_error("Snapshot checksum mismatch");
+    }
+    const char* neighbors = payload + offsets_size + snapshotPadding(offsets_size);
+    const char* weights = neighbors + neighbors_size + snapshotPadding(neighbors_size);
+
+    csr_graph.clear();
+    csr_graph.offsets.resize(header.n_rows + 1);
+    std::memcpy(csr_graph.offsets.data(), payload, offsets_size);
+    csr_graph.neighbors.resize(header.n_edges);
+    std::memcpy(csr_graph.neighbors.data(), neighbors, neighbors_size);
+    csr_graph.weights.resize(header.n_edges);
+    std::memcpy(csr_graph.weights.data(), weights, weights_size);
+    // the checksum only catches damage, the solver indexes by these
+    if (csr_graph.offsets[0] != 0 || csr_graph.offsets[header.n_rows] != header.n_edges) {
+        throw std::runtime_error("Corrupted snapshot: row offsets do not span the edges");
+    }
+    for (int64_t node = 0; node < header.n_rows; node++) {
+        if (csr_graph.offsets[node] > csr_graph.offsets[node + 1]) {
+            throw std::runtime_error("Corrupted snapshot: row offsets of node " + std::to_string(node) +
+                                     " go backwards");
+        }
+    }
+    for (int64_t edge = 0; edge < header.n_edges; edge++) {
+        if (csr_graph.neighbors[edge] < 0 || csr_graph.neighbors[edge] >= header.n_rows) {
+            throw std::runtime_error("Corrupted snapshot: edge " + std::to_string(edge) + " points to node " +
+                                     std::to_string(csr_graph.neighbors[edge]) + " of " +
+                                     std::to_string(header.n_rows));
+        }
+    }
+    csr_graph.compact();
+    constraint_terms = std::vector<ConstraintTerms>();
+    n_lits = header.n_lits;
+    encoding = static_cast<Encoding>(header.encoding);
+    n_constraints = header.n_constraints;
+    to_normalize_amount = 0;
+    built = true;
+}
+}
@@ -0,0 +1,65 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace mrfsat {
+/*
+    Binary snapshot of a built graph, written with --save-snapshot and
+    accepted anywhere an instance file is. The layout is the header below
+    followed by the adjacency of node ids 0 .. n_rows - 1 in compressed
+    sparse row form, each array starting on an 8 byte boundary:
+
+        int64_t  offsets[n_rows + 1]
+        int32_t  neighbors[n_edges]
+        float    weights[n_edges]
+
+    which is the in-memory CSRGraph, so loading is a copy. Only the
+    current version is read; older snapshots are refused rather than
+    guessed at, save them again from the instance. The checksum covers
+    everything after the header.
+*/
+static const char SNAPSHOT_MAGIC[8] = {'M', 'R', 'F', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t SNAPSHOT_VERSION = 3;
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int64_t n_lits;
+    int64_t n_constraints;
+    int64_t n_rows;
+    int64_t n_edges;
+    uint64_t checksum;
+    uint32_t encoding;
+    uint32_t reserved;
+};
+
+inline bool isSnapshot(const char* begin, size_t size) {
+    return size >= sizeof(SNAPSHOT_MAGIC) && std::memcmp(begin, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+inline size_t snapshotPadding(size_t size) {
+    return (8 - size % 8) % 8;
+}
+
+uint64_t snapshotChecksum(const char* data, size_t size);
+}
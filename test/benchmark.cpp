@@ -0,0 +1,82 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Times the solve of each instance, that is calculateGraphData on a
+    graph already parsed and built, over a number of rounds and prints the
+    fastest and the median round in milliseconds. Parsing and building are
+    left out of the time. --sweep full solves every flow network at every
+    parameter, which times the per-parameter work of the solver on its
+    own. Only public calls are used, so the same file builds against an
+    older tree to compare a change with its parent:
+
+        mrfsat_benchmark [--sweep full] <rounds> <filename>...
+*/
+
+#include "filereader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+static double solveMilliseconds(const std::string& file_name, bool full_sweep) {
+    mrfsat::FileReader reader;
+    if (full_sweep) reader.graph.setFullSweep(true);
+    if (!reader.parseFile(file_name)) {
+        throw std::runtime_error("Could not read " + file_name);
+    }
+    reader.graph.buildFromConstraints();
+    reader.graph.sparsify(0);
+    // the features go to std::cout, keep them out of the report
+    std::ostringstream features;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(features.rdbuf());
+    auto start = std::chrono::steady_clock::now();
+    reader.graph.calculateGraphData();
+    auto stop = std::chrono::steady_clock::now();
+    std::cout.rdbuf(stdout_buffer);
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int first = 1;
+    bool full_sweep = argc > 2 && std::string(argv[1]) == "--sweep" && std::string(argv[2]) == "full";
+    if (full_sweep) first += 2;
+    if (argc < first + 2 || std::atoi(argv[first]) < 1) {
+        std::cerr << "Usage: " << argv[0] << " [--sweep full] <rounds> <filename>..." << std::endl;
+        return 2;
+    }
+    int rounds = std::atoi(argv[first]);
+    try {
+        for (int file = first + 1; file < argc; file++) {
+            std::vector<double> times;
+            for (int round = 0; round < rounds; round++) {
+                times.push_back(solveMilliseconds(argv[file], full_sweep));
+            }
+            std::sort(times.begin(), times.end());
+            std::printf("%s: fastest %.3f ms, median %.3f ms over %d rounds\n",
+                        argv[file], times.front(), times[times.size() / 2], rounds);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+    MRFSAT - Copyright (C) 2023  Lukas Esteban Gutierrez Lisboa
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+    Solves one instance twice, the second time with a setting that must not
+    change the result, and fails unless both solves parse the same
+    constraints, print the same line and put every node in the same
+    community.
+
+        mrfsat_compare sparsify <instance>   every edge against the default
+                                             sparsification
+        mrfsat_compare coarsen <instance>    coarsened 1, 2 and 3 times against
+                                             the full solve
+        mrfsat_compare sweep <instance>      every parameter swept against the
+                                             default adaptive sweep
+        mrfsat_compare ordering <instance>   renumbered bfs, rcm and degree
+                                             against the parse order
+        mrfsat_compare add-constraints <instance> <added>
+                                             the constraints of added solved
+                                             again from scratch against the
+                                             update, both on the scale of the
+                                             first solve of instance
+        mrfsat_compare cnf <instance> <cnf instance>
+                                             the same clauses read from DIMACS
+                                             CNF against their OPB rewrite
+        mrfsat_compare lexer <instance>      the OPB lexer against the line
+                                             parser it replaced, kept below
+*/
+
+#include "filereader.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+struct SolveSettings {
+    float sparsify_epsilon = 0;
+    int coarsen_levels = 0;
+    bool full_sweep = false;
+    mrfsat::NodeOrdering ordering = mrfsat::NodeOrdering::Identity;
+    std::string added_constraints;
+    bool warm_update = true;
+    bool line_parser = false;
+};
+
+struct SolveResult {
+    std::string parsed;
+    std::string line;
+    std::vector<int> community_nodes;
+};
+
+/*
+    The OPB parser the lexer replaced: reads a line at a time, drops its
+    spaces and walks it with the same grammar, making the same Graph calls
+    in the same order. Only OPB files are read, whole and uncompressed.
+*/
+class LineParser {
+    public:
+        LineParser(mrfsat::Graph& g) : graph(g) {}
+        void parseFile(std::ifstream& file) {
+            while (std::getline(file, line)) {
+                //<equations> ::= <equation> | <equation> <equations>
+                line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+                if (line.empty() || line[0] == '*' || line.compare(0, 4, "min:") == 0 ||
+                    line.compare(0, 4, "max:") == 0) {
+                    continue;
+                }
+                stop = -1;
+                getEquation();
+                line_number++;
+            }
+            graph.setConstraintsNumber(line_number - 1);
+            graph.updateLiteralsAmount(max_variable_id * 2);
+        }
+    private:
+        void getEquation() {
+            //<equation> ::= <terms> <comparator> <integer> ";"
+            while (getTerm()) {}
+            bool equality = getComparator();
+            char sign = next();
+            if (sign != '-' && sign != '+') stop--;
+            graph.addConstraintCoefficient(line_number, (sign == '-' ? -1 : 1) * getInteger());
+            if (equality) graph.NormalizeEqualConstraint(line_number);
+            if (next() != ';') throw std::runtime_error("Syntax error: expected ;");
+        }
+        bool getComparator() {
+            //<comparator> ::= "=" | ">="
+            char first = next();
+            if (first == '=') return true;
+            if (first == '>' && next() == '=') return false;
+            throw std::runtime_error("No support for non-linear constraints " + std::to_string(line_number));
+        }
+        bool getTerm() {
+            //<term> ::= <sign> <integer> "x" <integer>
+            char sign = next();
+            if (sign != '-' && sign != '+') {
+                stop--;
+                return false;
+            }
+            int coefficient = getInteger();
+            if (next() != 'x') throw std::runtime_error("Syntax error: Term must have variable x.");
+            int variable = getInteger();
+            max_variable_id = std::max(variable, max_variable_id);
+            graph.addVariableToConstraint(line_number, std::pair<int, int>(sign == '-' ? -variable : variable, coefficient));
+            return true;
+        }
+        int getInteger() {
+            //<integer> ::= <digit> | <digit> <integer>
+            int number = 0;
+            for (char digit = next(); digit >= '0' && digit <= '9'; digit = next()) {
+                number = number * 10 + (digit - '0');
+            }
+            stop--;
+            return number;
+        }
+        char next() {
+            // past the end of the line reads as a character no rule takes
+            return ++stop < (int)line.size() ? line[stop] : '\0';
+        }
+        mrfsat::Graph& graph;
+        std::string line;
+        int stop = -1;
+        int line_number = 1;
+        int max_variable_id = 0;
+};
+
+static SolveResult solve(const std::string& file_name, const SolveSettings& settings) {
+    mrfsat::FileReader reader;
+    reader.graph.setCoarsening(settings.coarsen_levels);
+    reader.graph.setFullSweep(settings.full_sweep);
+    reader.graph.setOrdering(settings.ordering);
+    reader.graph.setIncremental(!settings.added_constraints.empty());
+    if (settings.line_parser) {
+        std::ifstream file(file_name);
+        if (!file) {
+            throw std::runtime_error("Could not read " + file_name);
+        }
+        LineParser(reader.graph).parseFile(file);
+    } else if (!reader.parseFile(file_name)) {
+        throw std::runtime_error("Could not read " + file_name);
+    }
+    // the constraints and the features go to std::cout, catch them
+    std::ostringstream parsed, line;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(parsed.rdbuf());
+    try {
+        reader.graph.showGraph();
+        std::cout.rdbuf(line.rdbuf());
+        reader.graph.buildFromConstraints();
+        reader.graph.sparsify(settings.sparsify_epsilon);
+        reader.graph.calculateGraphData();
+        if (!settings.added_constraints.empty()) {
+            mrfsat::FileReader added;
+            if (!added.parseFile(settings.added_constraints)) {
+                throw std::runtime_error("Could not read " + settings.added_constraints);
+            }
+            reader.graph.addConstraints(added.graph);
+            reader.graph.updateGraphData(settings.warm_update);
+        }
+    } catch (...) {
+        std::cout.rdbuf(stdout_buffer);
+        throw;
+    }
+    std::cout.rdbuf(stdout_buffer);
+    return SolveResult{parsed.str(), line.str(), reader.graph.community_nodes};
+}
+
+static bool sameResult(const SolveResult& expected, const SolveResult& actual, const std::string& setting) {
+    if (expected.parsed != actual.parsed) {
+        std::cerr << setting << " parsed other constraints" << std::endl;
+        return false;
+    }
+    if (expected.line != actual.line) {
+        std::cerr << setting << " printed " << actual.line << " instead of " << expected.line;
+        return false;
+    }
+    if (expected.community_nodes != actual.community_nodes) {
+        size_t node = 0;
+        while (node < expected.community_nodes.size() && node < actual.community_nodes.size() &&
+               expected.community_nodes[node] == actual.community_nodes[node]) {
+            node++;
+        }
+        std::cerr << setting << " put node " << node << " in another community" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool add_constraints = argc > 1 && std::string(argv[1]) == "add-constraints";
+    bool second_file = add_constraints || (argc > 1 && std::string(argv[1]) == "cnf");
+    if (argc != (second_file ? 4 : 3)) {
+        std::cerr << "Usage: " << argv[0] << " sparsify|coarsen|sweep|ordering|lexer <filename>" << std::endl;
+        std::cerr << "       " << argv[0] << " add-constraints <filename> <added constraints>" << std::endl;
+        std::cerr << "       " << argv[0] << " cnf <filename> <cnf filename>" << std::endl;
+        return 2;
+    }
+    std::string check = argv[1];
+    std::string file_name = argv[2];
+    try {
+        SolveSettings defaults;
+        if (add_constraints) defaults.added_constraints = argv[3];
+        SolveResult expected = solve(file_name, defaults);
+        if (check == "sparsify") {
+            SolveSettings every_edge;
+            every_edge.sparsify_epsilon = -1;
+            SolveResult unsparsified = solve(file_name, every_edge);
+            return sameResult(unsparsified, expected, "--sparsify-epsilon 0") ? 0 : 1;
+        }
+        if (check == "coarsen") {
+            bool same = true;
+            for (int levels = 1; levels <= 3; levels++) {
+                SolveSettings coarsened;
+                coarsened.coarsen_levels = levels;
+                same = sameResult(expected, solve(file_name, coarsened),
+                                  "--coarsen-levels " + std::to_string(levels)) && same;
+            }
+            return same ? 0 : 1;
+        }
+        if (check == "sweep") {
+            SolveSettings every_parameter;
+            every_parameter.full_sweep = true;
+            SolveResult full = solve(file_name, every_parameter);
+            return sameResult(full, expected, "--sweep adaptive") ? 0 : 1;
+        }
+        if (check == "add-constraints") {
+            SolveSettings cold = defaults;
+            cold.warm_update = false;
+            SolveResult solved_again = solve(file_name, cold);
+            return sameResult(solved_again, expected, "--add-constraints") ? 0 : 1;
+        }
+        if (check == "ordering") {
+            const std::pair<mrfsat::NodeOrdering, std::string> orderings[] = {
+                {mrfsat::NodeOrdering::BFS, "bfs"},
+                {mrfsat::NodeOrdering::ReverseCuthillMcKee, "rcm"},
+                {mrfsat::NodeOrdering::Degree, "degree"}};
+            bool same = true;
+            for (const auto& [ordering, name]: orderings) {
+                SolveSettings renumbered;
+                renumbered.ordering = ordering;
+                same = sameResult(expected, solve(file_name, renumbered), "--ordering " + name) && same;
+            }
+            return same ? 0 : 1;
+        }
+        if (check == "lexer") {
+            SolveSettings old_parser;
+            old_parser.line_parser = true;
+            SolveResult line_by_line = solve(file_name, old_parser);
+            return sameResult(line_by_line, expected, "the lexer") ? 0 : 1;
+        }
+        if (check == "cnf") {
+            std::string cnf_name = argv[3];
+            return sameResult(expected, solve(cnf_name, defaults), cnf_name) ? 0 : 1;
+        }
+        std::cerr << "Unknown check " << check << std::endl;
+        return 2;
+    } catch (const std::exception& ex) {
+        std::cerr << file_name << ": " << ex.what() << std::endl;
+        return 1;
+    }
+}